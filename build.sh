@@ -9,8 +9,23 @@ elif [[ "$1" == "--cli" ]]; then
     unset THEREMIN_GUI
 else
     echo "Please specify whether you wish to build Theresa with a graphical interface (option --gui) or with a command-line interface (option --cli)."
+    echo "Add the option --fixed-point to synthesize with integer math, e.g. on older Raspberry Pis."
+    echo "Add the option --alsa to play directly through ALSA (audio_backend = \"alsa\")."
+    echo "Add the option --rt-audit to report allocations, locks and blocking calls on the audio path (for debugging)."
     exit 0
 fi
+unset THEREMIN_FIXED_POINT
+unset THEREMIN_RT_AUDIT
+unset THEREMIN_ALSA
+for option in "${@:2}"; do
+    if [[ "$option" == "--fixed-point" ]]; then
+        export THEREMIN_FIXED_POINT=true
+    elif [[ "$option" == "--alsa" ]]; then
+        export THEREMIN_ALSA=true
+    elif [[ "$option" == "--rt-audit" ]]; then
+        export THEREMIN_RT_AUDIT=true
+    fi
+done
 
 # CMake build
 mkdir -p build
@@ -6,6 +6,10 @@ theresa_path=/home/pi/theresa
 cd "$theresa_path"
 echo >> theresa_log
 date >> theresa_log
+# Allow real-time priority and locked memory up to the hard limits
+# (used if realtime_enabled is set in theresa.cfg)
+ulimit -S -r "$(ulimit -H -r)" 2> /dev/null
+ulimit -S -l "$(ulimit -H -l)" 2> /dev/null
 LD_LIBRARY_PATH=tinkerforge/source/:/usr/local/lib/ ./theresa >> theresa_log 2>&1 &
 
 amixer sset 'PCM' 95%
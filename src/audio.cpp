@@ -1,19 +1,10 @@
 #include <iostream>
+#include <algorithm>
+#include <string.h>
 
 #include "const.h"
 #include "audio.hpp"
-
-/*
- * Convert between some amount of samples
- * and the corresponding amount of bytes.
- * 1 Sample = 16 bit = 2 byte
- */
-int bytes_to_samples(int bytes) {
-    return bytes / 2;
-}
-int samples_to_bytes(int samples) {
-    return samples * 2;
-}
+#include "timeline.hpp"
 
 /*
  * Initial audio settings
@@ -23,24 +14,30 @@ void Audio::setup_audio(Configuration* cfg) {
     bufferIdx = 0;
     this->cfg = cfg;
     bufferSize = cfg->i(BUFFER_SIZE);
-    buffer = new Uint16[bufferSize];
+    block.resize(bufferSize);
+    effects.setup(cfg, bufferSize);
     
-    SDL_AudioSpec wanted, having;
-
-    /* Set the audio format */
-    wanted.freq = cfg->i(SAMPLE_RATE);
-    wanted.format = AUDIO_S16;
-    wanted.channels = 1;    /* 1 = mono, 2 = stereo */
-    wanted.samples = bufferSize;
-    wanted.callback = NULL;
-    wanted.userdata = NULL;
-
-    /* Open the audio device, forcing the desired format */
-    deviceId = SDL_OpenAudioDevice(NULL, 0, &wanted, &having, 0);
-    if (deviceId < 0) {
-        fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
-        exit(1);
+    int sampleRate = cfg->i(SAMPLE_RATE);
+    int deviceRate = cfg->i(DEVICE_SAMPLE_RATE);
+    if (deviceRate <= 0) {
+        deviceRate = sampleRate;
+    }
+    backend = AudioBackend::create(cfg->str(AUDIO_BACKEND));
+    backend->setup(cfg, deviceRate, (long) bufferSize * deviceRate / sampleRate);
+    
+    // The backend may have settled for another rate
+    deviceRate = backend->get_sample_rate();
+    int maxOutputSize = bufferSize;
+    resampling = (deviceRate != sampleRate);
+    if (resampling) {
+        resampler.setup(sampleRate, deviceRate, cfg->i(RESAMPLER_TAPS), bufferSize);
+        maxOutputSize = resampler.max_output_size(bufferSize);
+        resampled.resize(maxOutputSize);
     }
+    buffer = new int16_t[maxOutputSize];
+    
+    scheduler.setup(cfg, (long) bufferSize * deviceRate / sampleRate, deviceRate,
+                    backend->get_capacity());
 }
 
 /*
@@ -52,7 +49,8 @@ void Audio::start_playing() {
     std::cout << "Started playing." << std::endl;
     isPlaying = true;
     
-    flush_buffer_to_sdl();
+    backend->start();
+    flush_buffer();
 }
 
 /*
@@ -81,7 +79,7 @@ void Audio::stop_replaying() {
 
 /*
  * Adds a single sample to the current audio buffer.
- * Also flushes the audio buffer to SDL when it is full.
+ * Also flushes the audio buffer to the backend when it is full.
  */
 bool Audio::new_sample(uint16_t sample) {
     
@@ -93,21 +91,21 @@ bool Audio::new_sample(uint16_t sample) {
     if (bufferIdx < bufferSize) {
         
         if (isReplaying) {
-            buffer[bufferIdx] = (Uint16) (0.5 * sample 
-                    + 0.5 * recordingBuffer[recordingBufferIdx]);
+            block[bufferIdx] = (0.5f * sample 
+                    + 0.5f * recordingBuffer[recordingBufferIdx]) / UINT16_MAX;
         } else {
-            buffer[bufferIdx] = (Uint16) (0.5 * sample);
-        }
-        
-        if (cfg->b(LOG_DATA)) {
-            std::cout << " " << (int) buffer[bufferIdx] << std::endl;
+            block[bufferIdx] = (float) sample / UINT16_MAX;
         }
         bufferIdx++;
         played = true;
     }
     
     if (bufferIdx == bufferSize) {
-        played = flush_buffer_to_sdl();
+        if (!blockProcessed) {
+            scheduler.block_rendered();
+            process_block();
+        }
+        played = flush_buffer();
     }
     
     if (played) {
@@ -124,27 +122,53 @@ bool Audio::new_sample(uint16_t sample) {
 }
 
 /*
- * If the buffer is full and if the SDL-internal queue of audio samples
- * is empty, the buffer data will be put into the queue.
+ * Applies the effects to the full block, resamples it to the rate of
+ * the backend if necessary and converts it into the buffer to be played.
+ */
+void Audio::process_block() {
+    
+    Timeline::Scope phase("process block");
+    effects.process(&block[0], bufferSize);
+    
+    const float* output = &block[0];
+    outputSize = bufferSize;
+    if (resampling) {
+        outputSize = resampler.process(&block[0], bufferSize, &resampled[0]);
+        output = &resampled[0];
+    }
+    
+    for (int i = 0; i < outputSize; i++) {
+        float value = std::min(std::max(output[i], -1.0f), 1.0f);
+        buffer[i] = (int16_t) (value * INT16_MAX);
+        
+        if (cfg->b(LOG_DATA)) {
+            std::cout << " " << (int) buffer[i] << std::endl;
+        }
+    }
+    blockProcessed = true;
+}
+
+/*
+ * If the buffer is full and if the queue of the backend has dropped
+ * below its target depth, the buffer data will be handed over.
  * Afterwards, the buffer can be overwritten with new data.
  * Returns true iff the buffer has been flushed.
  */
-bool Audio::flush_buffer_to_sdl() {
+bool Audio::flush_buffer() {
     
-    if (isPlaying && bytes_to_samples(SDL_GetQueuedAudioSize(deviceId)) == 0) {
-        
-        int errCode = SDL_QueueAudio(deviceId, &buffer[0], 
-                                     samples_to_bytes(bufferSize));
-        if (errCode != 0) {
-            fprintf(stderr, "Couldn't play audio: %s\n", SDL_GetError());
-            exit(1);
-        } else {
-            
-            SDL_PauseAudioDevice(deviceId, 0);
-            bufferIdx = 0;
-            return true;
+    if (!isPlaying) {
+        return false;
+    }
+    int queued = backend->get_queued_samples();
+    if (scheduler.is_ready(queued)) {
+        {
+            Timeline::Scope phase("device write");
+            backend->write(buffer, outputSize);
         }
-        
+        scheduler.block_written(queued);
+        bufferIdx = 0;
+        blockProcessed = false;
+        return true;
     }
     return false;
 }
@@ -162,7 +186,8 @@ bool Audio::is_buffer_full() {
 void Audio::reset() {
         
     bufferIdx = 0;
-    memset(&buffer[0], 0, sizeof(buffer));
+    blockProcessed = false;
+    memset(&buffer[0], 0, outputSize * sizeof(*buffer));
 }
 
 /*
@@ -173,7 +198,9 @@ void Audio::set_exiting(bool isExiting) {
     
     this->exiting = isExiting;
     isPlaying = false;
-    delete buffer;
+    backend->finish();
+    delete backend;
+    delete[] buffer;
 }
 
 /*
@@ -188,3 +215,11 @@ bool Audio::is_recording() {
 bool Audio::is_replaying() {
     return isReplaying;
 }
+
+EffectsChain* Audio::get_effects() {
+    return &effects;
+}
+
+OutputScheduler* Audio::get_scheduler() {
+    return &scheduler;
+}
@@ -2,10 +2,13 @@
 #define THEREMIN_AUDIO_H
 
 #include <stdint.h>
-#include <SDL2/SDL.h>
 #include <vector>
 
 #include "configuration.hpp"
+#include "effects_chain.hpp"
+#include "audio_backend.hpp"
+#include "output_scheduler.hpp"
+#include "resampler.hpp"
 
 class Audio {
 
@@ -24,11 +27,15 @@ public:
     bool is_playing();
     bool is_recording();
     bool is_replaying();
+    EffectsChain* get_effects();
+    OutputScheduler* get_scheduler();
 
 private:
-    bool flush_buffer_to_sdl();
+    void process_block();
+    bool flush_buffer();
     
-    int deviceId;
+    AudioBackend* backend;
+    OutputScheduler scheduler;
     
     bool exiting = false;
     bool isPlaying = false;
@@ -37,11 +44,25 @@ private:
     
     Configuration* cfg;
     
+    // Size of the rendered block (at the sample rate of the synthesizer)
+    // and of the output in the buffer (at the rate of the backend)
     int bufferSize;
-    Uint16* buffer;
+    int16_t* buffer;
     int bufferIdx;
+    int outputSize = 0;
     
-    std::vector<Uint16> recordingBuffer;
+    // Samples of the current buffer before the effects are applied,
+    // normalized such that the synthesizer's output is within [0,1]
+    std::vector<float> block;
+    bool blockProcessed = false;
+    EffectsChain effects;
+    
+    // Only if the backend runs at a different rate
+    bool resampling = false;
+    Resampler resampler;
+    std::vector<float> resampled;
+    
+    std::vector<uint16_t> recordingBuffer;
     int recordingBufferIdx;
 };
     
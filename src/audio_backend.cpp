@@ -0,0 +1,30 @@
+#include <iostream>
+
+#include "const.h"
+#include "audio_backend.hpp"
+#include "audio_backends.hpp"
+
+/*
+ * Creates the audio backend with the given name (one of the
+ * AUDIO_BACKEND_* values). Exits if there is no such backend.
+ */
+AudioBackend* AudioBackend::create(std::string name) {
+
+    if (name == AUDIO_BACKEND_SDL) {
+        return new SdlBackend();
+    } else if (name == AUDIO_BACKEND_NULL) {
+        return new NullBackend();
+    } else if (name == AUDIO_BACKEND_FILE) {
+        return new FileBackend();
+    } else if (name == AUDIO_BACKEND_PIPE) {
+        return new PipeBackend();
+#ifdef THEREMIN_ALSA
+    } else if (name == AUDIO_BACKEND_ALSA) {
+        return new AlsaBackend();
+#endif
+    }
+
+    std::cerr << "Error: Audio backend \"" << name
+            << "\" is not available." << std::endl;
+    exit(1);
+}
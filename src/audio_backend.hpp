@@ -0,0 +1,44 @@
+#ifndef THEREMIN_AUDIO_BACKEND_H
+#define THEREMIN_AUDIO_BACKEND_H
+
+#include <stdint.h>
+#include <string>
+
+#include "configuration.hpp"
+
+/*
+ * A sink for the rendered audio: takes blocks of signed 16-bit mono
+ * samples at the rate the sink has agreed to, which may differ from the
+ * requested one (Audio resamples then). Backends which play in realtime report how
+ * many samples they still hold, such that Audio can keep their queue
+ * at a target depth and keep rendering in the meantime.
+ */
+class AudioBackend {
+
+public:
+    virtual ~AudioBackend() {}
+
+    // Opens the sink at (or near) the given rate for blocks of about the
+    // given size, exiting with an error message if impossible
+    virtual void setup(Configuration* cfg, int sampleRate, int blockSize) = 0;
+    // Called once before the first block
+    virtual void start() {}
+    // Samples written but not played yet, or -1 if the backend
+    // takes blocks as fast as they are rendered
+    virtual int get_queued_samples() = 0;
+    // Maximal number of queued samples, or 0 if unbounded
+    virtual int get_capacity() { return 0; }
+    virtual void write(const int16_t* samples, int numSamples) = 0;
+    // Flushes and closes the sink
+    virtual void finish() {}
+
+    // The rate negotiated by setup()
+    int get_sample_rate() { return sampleRate; }
+
+    static AudioBackend* create(std::string name);
+
+protected:
+    int sampleRate;
+};
+
+#endif
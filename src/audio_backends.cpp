@@ -0,0 +1,283 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "audio_backends.hpp"
+
+/*
+ * SDL
+ */
+
+void SdlBackend::setup(Configuration* cfg, int sampleRate, int blockSize) {
+
+    SDL_AudioSpec wanted, having;
+
+    /* Set the audio format */
+    wanted.freq = sampleRate;
+    wanted.format = AUDIO_S16;
+    wanted.channels = 1;    /* 1 = mono, 2 = stereo */
+    wanted.samples = blockSize;
+    wanted.callback = NULL;
+    wanted.userdata = NULL;
+
+    /* Open the audio device, forcing the desired format
+     * but letting the device choose its rate and buffer size */
+    deviceId = SDL_OpenAudioDevice(NULL, 0, &wanted, &having,
+            SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+    if (deviceId == 0) {
+        fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+        exit(1);
+    }
+    this->sampleRate = having.freq;
+    std::cout << "Opened SDL audio device: " << having.freq << " Hz, "
+            << having.samples << " samples per device buffer." << std::endl;
+}
+
+void SdlBackend::start() {
+    SDL_PauseAudioDevice(deviceId, 0);
+}
+
+int SdlBackend::get_queued_samples() {
+    return SDL_GetQueuedAudioSize(deviceId) / sizeof(int16_t);
+}
+
+void SdlBackend::write(const int16_t* samples, int numSamples) {
+
+    int errCode = SDL_QueueAudio(deviceId, samples, numSamples * sizeof(int16_t));
+    if (errCode != 0) {
+        fprintf(stderr, "Couldn't play audio: %s\n", SDL_GetError());
+        exit(1);
+    }
+}
+
+/*
+ * File
+ */
+
+static void write_u32(FILE* file, uint32_t value) {
+    uint8_t bytes[4] = {(uint8_t) value, (uint8_t) (value >> 8),
+                        (uint8_t) (value >> 16), (uint8_t) (value >> 24)};
+    fwrite(bytes, 1, 4, file);
+}
+
+static void write_u16(FILE* file, uint16_t value) {
+    uint8_t bytes[2] = {(uint8_t) value, (uint8_t) (value >> 8)};
+    fwrite(bytes, 1, 2, file);
+}
+
+void FileBackend::setup(Configuration* cfg, int sampleRate, int blockSize) {
+
+    this->sampleRate = sampleRate;
+
+    std::string path = cfg->str(AUDIO_FILE);
+    wav = (path.size() >= 4 && path.compare(path.size() - 4, 4, ".wav") == 0);
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        std::cerr << "Error: Could not write \"" << path << "\"." << std::endl;
+        exit(1);
+    }
+    if (wav) {
+        // The sizes are filled in by finish()
+        write_wav_header();
+    }
+}
+
+void FileBackend::write(const int16_t* samples, int numSamples) {
+
+    // Samples are little endian on all supported platforms
+    fwrite(samples, sizeof(int16_t), numSamples, file);
+    this->numSamples += numSamples;
+}
+
+void FileBackend::finish() {
+
+    if (file == NULL) {
+        return;
+    }
+    if (wav) {
+        fseek(file, 0, SEEK_SET);
+        write_wav_header();
+    }
+    fclose(file);
+    file = NULL;
+}
+
+void FileBackend::write_wav_header() {
+
+    uint32_t dataSize = numSamples * 2;
+    fwrite("RIFF", 1, 4, file);
+    write_u32(file, 36 + dataSize);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_u32(file, 16);
+    write_u16(file, 1); // PCM
+    write_u16(file, 1); // mono
+    write_u32(file, sampleRate);
+    write_u32(file, sampleRate * 2);
+    write_u16(file, 2);
+    write_u16(file, 16);
+    fwrite("data", 1, 4, file);
+    write_u32(file, dataSize);
+}
+
+/*
+ * Pipe
+ */
+
+void PipeBackend::setup(Configuration* cfg, int sampleRate, int blockSize) {
+
+    this->sampleRate = sampleRate;
+
+    // Keep the original stdout for the samples only
+    fflush(stdout);
+    fd = dup(STDOUT_FILENO);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        perror("Could not redirect the standard output");
+        exit(1);
+    }
+}
+
+void PipeBackend::write(const int16_t* samples, int numSamples) {
+
+    const char* bytes = (const char*) samples;
+    int blockBytes = numSamples * sizeof(int16_t);
+    int written = 0;
+    while (written < blockBytes) {
+        ssize_t result = ::write(fd, bytes + written, blockBytes - written);
+        if (result < 0 && errno != EINTR) {
+            perror("Could not write to the pipe");
+            exit(1);
+        } else if (result > 0) {
+            written += result;
+        }
+    }
+}
+
+/*
+ * ALSA
+ */
+
+#ifdef THEREMIN_ALSA
+
+void AlsaBackend::setup(Configuration* cfg, int sampleRate, int blockSize) {
+
+    std::string device = cfg->str(ALSA_DEVICE);
+
+    check(snd_pcm_open(&pcm, device.c_str(), SND_PCM_STREAM_PLAYBACK,
+                       SND_PCM_NONBLOCK), "open the device");
+
+    // Hardware parameters: one block per period
+    snd_pcm_hw_params_t* hwParams;
+    snd_pcm_hw_params_alloca(&hwParams);
+    check(snd_pcm_hw_params_any(pcm, hwParams), "query the device");
+    check(snd_pcm_hw_params_set_access(pcm, hwParams,
+            SND_PCM_ACCESS_MMAP_INTERLEAVED), "set memory-mapped access");
+    check(snd_pcm_hw_params_set_format(pcm, hwParams, SND_PCM_FORMAT_S16),
+          "set the sample format");
+    check(snd_pcm_hw_params_set_channels(pcm, hwParams, 1), "set mono output");
+    unsigned int rate = sampleRate;
+    check(snd_pcm_hw_params_set_rate_near(pcm, hwParams, &rate, 0),
+          "set the sample rate");
+    this->sampleRate = rate;
+    snd_pcm_uframes_t periodSize = blockSize;
+    check(snd_pcm_hw_params_set_period_size_near(pcm, hwParams, &periodSize, 0),
+          "set the period size");
+    unsigned int periods = cfg->i(ALSA_PERIODS);
+    check(snd_pcm_hw_params_set_periods_near(pcm, hwParams, &periods, 0),
+          "set the number of periods");
+    check(snd_pcm_hw_params(pcm, hwParams), "apply the hardware parameters");
+    check(snd_pcm_hw_params_get_buffer_size(hwParams, &bufferFrames),
+          "query the buffer size");
+
+    // Wake up whenever a block fits
+    snd_pcm_sw_params_t* swParams;
+    snd_pcm_sw_params_alloca(&swParams);
+    check(snd_pcm_sw_params_current(pcm, swParams), "query the device");
+    check(snd_pcm_sw_params_set_avail_min(pcm, swParams, blockSize),
+          "set the minimal available space");
+    check(snd_pcm_sw_params(pcm, swParams), "apply the software parameters");
+
+    std::cout << "Opened ALSA device " << device << ": " << rate << " Hz, "
+            << periods << " periods of " << periodSize << " samples." << std::endl;
+}
+
+int AlsaBackend::get_queued_samples() {
+
+    snd_pcm_sframes_t available = snd_pcm_avail_update(pcm);
+    if (available < 0) {
+        // Recover from an underrun, which leaves the buffer empty
+        check(snd_pcm_recover(pcm, available, 1), "recover from an underrun");
+        return 0;
+    }
+    return std::max(0, (int) (bufferFrames - available));
+}
+
+int AlsaBackend::get_capacity() {
+    return bufferFrames;
+}
+
+/*
+ * Copies the samples into the ring buffer of the device, in up to two
+ * parts if they wrap around. Starts playing right away, and again after
+ * an underrun: the depth of the queue is up to the OutputScheduler.
+ */
+void AlsaBackend::write(const int16_t* samples, int numSamples) {
+
+    snd_pcm_uframes_t remaining = numSamples;
+    while (remaining > 0) {
+
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = remaining;
+        int errCode = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+        if (errCode < 0) {
+            check(snd_pcm_recover(pcm, errCode, 1), "recover from an underrun");
+            continue;
+        } else if (frames == 0) {
+            // Only if the buffer is full: wait for space
+            snd_pcm_wait(pcm, 100);
+            continue;
+        }
+
+        int16_t* target = (int16_t*) areas[0].addr
+                + (areas[0].first + offset * areas[0].step) / 16;
+        memcpy(target, samples, frames * sizeof(int16_t));
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm, offset, frames);
+        if (committed < 0) {
+            check(snd_pcm_recover(pcm, committed, 1), "recover from an underrun");
+            continue;
+        }
+        samples += committed;
+        remaining -= committed;
+    }
+
+    if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED) {
+        check(snd_pcm_start(pcm), "start playing");
+    }
+}
+
+void AlsaBackend::finish() {
+
+    if (pcm != NULL) {
+        snd_pcm_drop(pcm);
+        snd_pcm_close(pcm);
+        pcm = NULL;
+    }
+}
+
+/*
+ * Exits with an error message if the given ALSA call failed.
+ */
+void AlsaBackend::check(int errCode, const char* action) {
+
+    if (errCode < 0) {
+        std::cerr << "Error: Could not " << action << " (ALSA: "
+                << snd_strerror(errCode) << ")." << std::endl;
+        exit(1);
+    }
+}
+
+#endif
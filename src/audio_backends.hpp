@@ -0,0 +1,103 @@
+#ifndef THEREMIN_AUDIO_BACKENDS_H
+#define THEREMIN_AUDIO_BACKENDS_H
+
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#ifdef THEREMIN_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+#include "audio_backend.hpp"
+
+/*
+ * Plays through SDL's (unbounded) queue of audio samples.
+ */
+class SdlBackend : public AudioBackend {
+
+public:
+    void setup(Configuration* cfg, int sampleRate, int blockSize);
+    void start();
+    int get_queued_samples();
+    void write(const int16_t* samples, int numSamples);
+
+private:
+    SDL_AudioDeviceID deviceId;
+};
+
+/*
+ * Discards all samples as fast as they are rendered, e.g. to
+ * measure the throughput of the whole pipeline.
+ */
+class NullBackend : public AudioBackend {
+
+public:
+    void setup(Configuration* cfg, int sampleRate, int blockSize) {
+        this->sampleRate = sampleRate;
+    }
+    int get_queued_samples() { return -1; }
+    void write(const int16_t* samples, int numSamples) {}
+};
+
+/*
+ * Writes all samples into a WAV file, or into a file of raw
+ * samples (signed 16-bit little endian) if the file name does not
+ * end with ".wav". Blocks are written as fast as they are rendered.
+ */
+class FileBackend : public AudioBackend {
+
+public:
+    void setup(Configuration* cfg, int sampleRate, int blockSize);
+    int get_queued_samples() { return -1; }
+    void write(const int16_t* samples, int numSamples);
+    void finish();
+
+private:
+    void write_wav_header();
+
+    FILE* file = NULL;
+    bool wav;
+    uint32_t numSamples = 0;
+};
+
+/*
+ * Writes raw samples (signed 16-bit little endian) to the standard
+ * output, e.g. to be piped into aplay or an encoder. Any other
+ * output to stdout is redirected to stderr. Writes block whenever
+ * the reading end does not keep up.
+ */
+class PipeBackend : public AudioBackend {
+
+public:
+    void setup(Configuration* cfg, int sampleRate, int blockSize);
+    int get_queued_samples() { return -1; }
+    void write(const int16_t* samples, int numSamples);
+
+private:
+    int fd;
+};
+
+#ifdef THEREMIN_ALSA
+/*
+ * Plays directly through an ALSA device, writing each block into the
+ * memory-mapped ring buffer of the device: no intermediate queue,
+ * such that the latency is that of the queued periods (one period
+ * being one block), bounded by the configured number of periods.
+ */
+class AlsaBackend : public AudioBackend {
+
+public:
+    void setup(Configuration* cfg, int sampleRate, int blockSize);
+    int get_queued_samples();
+    int get_capacity();
+    void write(const int16_t* samples, int numSamples);
+    void finish();
+
+private:
+    void check(int errCode, const char* action);
+
+    snd_pcm_t* pcm = NULL;
+    snd_pcm_uframes_t bufferFrames;
+};
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cmath>
 #include <libconfig.h++>
 
 #include "configuration.hpp"
@@ -18,49 +19,174 @@ void Configuration::load() {
 }
 
 bool Configuration::b(const char* value) {
+    return get<bool>(value);
+}
+
+int Configuration::i(const char* value) {
+    return get<int>(value);
+}
+
+double Configuration::d(const char* value) {
+    return get<double>(value);
+}
+
+std::string Configuration::str(const char* value) {
+    return get<std::string>(value);
+}
+
+/*
+ * Returns the numbers of the array or list with the given name,
+ * converting integer entries to floating point values.
+ */
+std::vector<double> Configuration::d_list(const char* value) {
     
-    bool result;
-    if (config.getRoot().lookupValue(value, result)) {
-        return result;
-    } else {
+    std::vector<double> result;
+    const Setting* list = find(value);
+    if (list == NULL) {
         std::cerr << "Error: Illegal configuration query \"" 
             << value << "\"." << std::endl;
         exit(1);
-    }       
+    }
+    
+    for (int i = 0; i < list->getLength(); i++) {
+        if ((*list)[i].getType() == Setting::TypeInt) {
+            result.push_back((int) (*list)[i]);
+        } else if ((*list)[i].getType() == Setting::TypeFloat) {
+            result.push_back((double) (*list)[i]);
+        } else {
+            std::cerr << "Error: Configuration entry \"" << value 
+                << "\" must only contain numbers." << std::endl;
+            exit(1);
+        }
+    }
+    return result;
 }
 
-int Configuration::i(const char* value) {
+/*
+ * Returns the strings of the array or list with the given name.
+ */
+std::vector<std::string> Configuration::str_list(const char* value) {
     
-    int result;
-    if (config.getRoot().lookupValue(value, result)) {
-        return result;
-    } else {
+    std::vector<std::string> result;
+    const Setting* list = find(value);
+    if (list == NULL) {
         std::cerr << "Error: Illegal configuration query \"" 
             << value << "\"." << std::endl;
         exit(1);
     }
+    
+    for (int i = 0; i < list->getLength(); i++) {
+        if ((*list)[i].getType() != Setting::TypeString) {
+            std::cerr << "Error: Configuration entry \"" << value 
+                << "\" must only contain strings." << std::endl;
+            exit(1);
+        }
+        result.push_back((const char*) (*list)[i]);
+    }
+    return result;
 }
 
-double Configuration::d(const char* value) {
+/*
+ * Checks whether there is a setting with the given name,
+ * e.g. for optional settings of list entries.
+ */
+bool Configuration::has(const char* value) {
+    return find(value) != NULL;
+}
+
+/*
+ * Overrides the number with the given name, which must be a setting
+ * of the root configuration (e.g. to render at another sample rate).
+ * Integer settings are set to the rounded value.
+ */
+void Configuration::set(const char* value, double result) {
     
-    double result;
-    if (config.getRoot().lookupValue(value, result)) {
-        return result;
+    if (scope != NULL || !config.exists(value)) {
+        std::cerr << "Error: Illegal configuration override \"" 
+            << value << "\"." << std::endl;
+        exit(1);
+    }
+    Setting& setting = config.lookup(value);
+    if (setting.getType() == Setting::TypeInt) {
+        setting = (int) std::lround(result);
+    } else if (setting.getType() == Setting::TypeFloat) {
+        setting = result;
     } else {
+        std::cerr << "Error: Configuration entry \"" << value 
+            << "\" must be a number." << std::endl;
+        exit(1);
+    }
+}
+
+/*
+ * Returns the amount of entries inside the list with the given name.
+ */
+int Configuration::num_entries(const char* list) {
+    
+    const Setting* setting = find(list);
+    if (setting == NULL) {
         std::cerr << "Error: Illegal configuration query \"" 
-            << value << "\"." << std::endl;
+            << list << "\"." << std::endl;
         exit(1);
     }
+    return setting->getLength();
 }
 
-std::string Configuration::str(const char* value) {
+/*
+ * Returns a new configuration for the idx-th entry of the list with
+ * the given name. Queries which the entry does not define are 
+ * answered by this configuration.
+ */
+Configuration* Configuration::entry(const char* list, int idx) {
     
-    std::string result;
-    if (config.getRoot().lookupValue(value, result)) {
+    if (idx < 0 || idx >= num_entries(list)) {
+        std::cerr << "Error: Illegal configuration query \"" 
+            << list << "\" [" << idx << "]." << std::endl;
+        exit(1);
+    }
+    Configuration* entryCfg = new Configuration();
+    entryCfg->parent = this;
+    entryCfg->scope = &(*find(list))[idx];
+    return entryCfg;
+}
+
+/*
+ * Finds the setting with the given name, respecting the scope
+ * of this configuration. Returns NULL if there is no such setting.
+ */
+const Setting* Configuration::find(const char* value) {
+    
+    if (scope != NULL) {
+        if (scope->exists(value)) {
+            return &scope->lookup(value);
+        }
+        return parent->find(value);
+    }
+    if (config.exists(value)) {
+        return &config.lookup(value);
+    }
+    return NULL;
+}
+
+template <typename T> 
+bool Configuration::lookup(const char* value, T& result) {
+    
+    if (scope != NULL) {
+        return scope->lookupValue(value, result) 
+            || parent->lookup(value, result);
+    }
+    return config.getRoot().lookupValue(value, result);
+}
+
+template <typename T> 
+T Configuration::get(const char* value) {
+    
+    T result;
+    if (lookup(value, result)) {
         return result;
     } else {
         std::cerr << "Error: Illegal configuration query \"" 
             << value << "\"." << std::endl;
         exit(1);
-    }   
+    }
 }
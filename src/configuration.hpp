@@ -2,6 +2,7 @@
 #define THEREMIN_CONFIGURATION_H
 
 #include <iostream>
+#include <vector>
 #include <libconfig.h++>
 
 using namespace libconfig;
@@ -11,6 +12,12 @@ class Configuration {
 private:
     Config config;
     
+    // Set for configurations describing an entry of a list 
+    // (e.g. an instrument of the ensemble): Settings of the entry 
+    // take precedence over the settings of the parent configuration.
+    Configuration* parent = NULL;
+    const Setting* scope = NULL;
+    
 public:
     void load();
     
@@ -18,6 +25,18 @@ public:
     int i(const char* value);
     double d(const char* value);
     std::string str(const char* value);
+    std::vector<double> d_list(const char* value);
+    std::vector<std::string> str_list(const char* value);
+    bool has(const char* value);
+    void set(const char* value, double result);
+    
+    int num_entries(const char* list);
+    Configuration* entry(const char* list, int idx);
+    
+private:
+    const Setting* find(const char* value);
+    template <typename T> bool lookup(const char* value, T& result);
+    template <typename T> T get(const char* value);
 };
 
 #endif
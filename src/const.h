@@ -7,6 +7,14 @@
 #define REALTIME_DISPLAY "realtime_display"
 #define LOG_DATA "log_data"
 #define LOG_FREQ "log_freq"
+#define ENSEMBLE "ensemble"
+#define RENDER_CORE "render_core"
+#define INSTRUMENT_GAIN "instrument_gain"
+#define REALTIME_ENABLED "realtime_enabled"
+#define REALTIME_PRIORITY "realtime_priority"
+#define REALTIME_LOCK_MEMORY "realtime_lock_memory"
+#define AUDIO_CORE "audio_core"
+#define CONTROL_CORE "control_core"
 
 #define TASK_FREQUENCY_INPUT_MOUSE "task_frequency_input_mouse"
 #define TASK_FREQUENCY_INPUT_SENSOR "task_frequency_input_sensor"
@@ -17,15 +25,85 @@
 #define MAX_VOLUME_CHANGE_PER_TICK "max_volume_change_per_tick"
 #define SAMPLE_RATE "sample_rate"
 #define BUFFER_SIZE "buffer_size"
+#define DEVICE_SAMPLE_RATE "device_sample_rate"
+#define RESAMPLER_TAPS "resampler_taps"
+#define AUDIO_BACKEND "audio_backend"
+#define AUDIO_QUEUE_MIN_BLOCKS "audio_queue_min_blocks"
+#define AUDIO_QUEUE_MAX_BLOCKS "audio_queue_max_blocks"
+#define AUDIO_QUEUE_SHRINK_AFTER "audio_queue_shrink_after"
+#define AUDIO_FILE "audio_file"
+#define ALSA_DEVICE "alsa_device"
+#define ALSA_PERIODS "alsa_periods"
+#define PERFORMANCE_CAPTURE "performance_capture"
 
 #define WAVEFORM "waveform"
+#define OSCILLATOR_SQUARE "oscillator_square"
+#define OSCILLATOR_SAW "oscillator_saw"
+#define OSCILLATOR_TRIANGLE "oscillator_triangle"
+#define OSCILLATOR_PLATEAU "oscillator_plateau"
+#define TIMBRE "timbre"
+#define TIMBRES "timbres"
+#define TIMBRE_NAME "name"
+#define TIMBRE_RATIOS "ratios"
+#define TIMBRE_AMPLITUDES "amplitudes"
+#define TIMBRE_PHASES "phases"
+#define MORPH_WAVEFORMS "morph_waveforms"
+#define MORPH_POSITION "morph_position"
+#define MORPH_TIME "morph_time"
+#define WAVETABLE_DIR "wavetable_dir"
+#define WAVETABLE_POLL_MS "wavetable_poll_ms"
+#define TUNING "tuning"
+#define TUNING_REFERENCE "tuning_reference"
+#define TUNING_KEYBOARD "tuning_keyboard"
 #define LOWEST_NOTE "lowest_note"
 #define NUM_OCTAVES "num_octaves"
 #define AUTOTUNE_MODE "autotune_mode"
+#define AUTOTUNE_SCALE "autotune_scale"
+#define AUTOTUNE_ROOT "autotune_root"
+#define AUTOTUNE_STRENGTH "autotune_strength"
+#define AUTOTUNE_CUSTOM_SCALE "autotune_custom_scale"
+#define CHORD_CROSSFADE_MS "chord_crossfade_ms"
+#define CHORD_DECAY_MS "chord_decay_ms"
+#define CHORD_SUSTAIN "chord_sustain"
+#define VIBRATO_ENABLED "vibrato_enabled"
+#define VIBRATO_SHAPE "vibrato_shape"
+#define VIBRATO_FREQUENCY "vibrato_frequency"
+#define VIBRATO_SYNC_BEATS "vibrato_sync_beats"
+#define VIBRATO_DEPTH "vibrato_depth"
+#define LFO_TEMPO "lfo_tempo"
 
+#define EFFECTS "effects"
+#define EFFECT_TYPE "type"
+#define GAIN_DB "gain_db"
 #define TREMOLO_ENABLED "tremolo_enabled"
 #define TREMOLO_FREQUENCY "tremolo_frequency"
 #define TREMOLO_INTENSITY "tremolo_intensity"
+#define TREMOLO_SHAPE "tremolo_shape"
+#define TREMOLO_SYNC_BEATS "tremolo_sync_beats"
+#define FILTER_ENABLED "filter_enabled"
+#define FILTER_TYPE "filter_type"
+#define FILTER_CUTOFF "filter_cutoff"
+#define FILTER_RESONANCE "filter_resonance"
+#define FILTER_LFO_SHAPE "filter_lfo_shape"
+#define FILTER_LFO_FREQUENCY "filter_lfo_frequency"
+#define FILTER_LFO_SYNC_BEATS "filter_lfo_sync_beats"
+#define FILTER_LFO_DEPTH "filter_lfo_depth"
+#define DELAY_ENABLED "delay_enabled"
+#define DELAY_MODE "delay_mode"
+#define DELAY_INTERPOLATION "delay_interpolation"
+#define DELAY_TIME "delay_time"
+#define DELAY_FEEDBACK "delay_feedback"
+#define DELAY_MIX "delay_mix"
+#define DELAY_MOD_RATE "delay_mod_rate"
+#define DELAY_MOD_DEPTH "delay_mod_depth"
+#define REVERB_ENABLED "reverb_enabled"
+#define REVERB_TIME "reverb_time"
+#define REVERB_SIZE "reverb_size"
+#define REVERB_DAMPING "reverb_damping"
+#define REVERB_PREDELAY "reverb_predelay"
+#define REVERB_MIX "reverb_mix"
+#define LIMITER_THRESHOLD "limiter_threshold"
+#define LIMITER_RELEASE "limiter_release"
 
 #define UID_FREQUENCY "uid_frequency"
 #define UID_VOLUME "uid_volume"
@@ -37,6 +115,10 @@
 #define SENSOR_VOL_MIN_VALUE "sensor_vol_min_value"
 #define SENSOR_VOL_MAX_VALUE "sensor_vol_max_value"
 
+#define SENSOR_TRACE_RECORD "sensor_trace_record"
+#define SENSOR_TRACE_REPLAY "sensor_trace_replay"
+#define SENSOR_TRACE_REALTIME "sensor_trace_realtime"
+
 #define ACTION_SUSTAIN_NOTE "action_sustain_note"
 #define ACTION_OCTAVE_UP "action_octave_up"
 #define ACTION_CHANGE_WAVEFORM "action_change_waveform"
@@ -44,6 +126,7 @@
 #define ACTION_AUTOTUNE_SMOOTH "action_autotune_smooth"
 #define ACTION_AUTOTUNE_FULL "action_autotune_full"
 #define ACTION_TREMOLO "action_tremolo"
+#define ACTION_VIBRATO "action_vibrato"
 #define ACTION_RECORDING_REPLAYING "action_recording_replaying"
 #define ACTION_CHORD_MAJOR_1 "action_chord_major_1"
 #define ACTION_CHORD_MAJOR_3 "action_chord_major_3"
@@ -52,12 +135,88 @@
 #define ACTION_CHORD_MINOR_3 "action_chord_minor_3"
 #define ACTION_CHORD_MINOR_5 "action_chord_minor_5"
 #define ACTION_CHORD_CLEAR "action_chord_clear"
+#define ACTION_DUMP_TIMELINE "action_dump_timeline"
+
+#define MOCK_CURVE "mock_curve"
+#define MOCK_CURVE_PERIOD "mock_curve_period"
+#define MOCK_LATENCY_MS "mock_latency_ms"
+#define MOCK_JITTER_MS "mock_jitter_ms"
+#define MOCK_DELAY_PROBABILITY "mock_delay_probability"
+#define MOCK_DELAY_MS "mock_delay_ms"
+
+#define OSC_ENABLED "osc_enabled"
+#define OSC_HOST "osc_host"
+#define OSC_PORT "osc_port"
+
+#define METRICS_ENABLED "metrics_enabled"
+#define METRICS_PORT "metrics_port"
+#define METRICS_SOCKET "metrics_socket"
+
+#define TIMELINE_ENABLED "timeline_enabled"
+#define TIMELINE_EVENTS "timeline_events"
+#define TIMELINE_FILE "timeline_file"
 
 /* CONFIGURATION VALUES */
 
 // Input device
 #define INPUT_DEVICE_MOUSE "mouse"
 #define INPUT_DEVICE_SENSOR "sensor"
+#define INPUT_DEVICE_TRACE "trace"
+#define INPUT_DEVICE_STDIN "stdin"
+#define INPUT_DEVICE_OSC "osc"
+
+// Audio backends
+#define AUDIO_BACKEND_SDL "sdl"
+#define AUDIO_BACKEND_ALSA "alsa"
+#define AUDIO_BACKEND_NULL "null"
+#define AUDIO_BACKEND_FILE "file"
+#define AUDIO_BACKEND_PIPE "pipe"
+
+// Effects
+#define EFFECT_GAIN "gain"
+#define EFFECT_TREMOLO "tremolo"
+#define EFFECT_FILTER "filter"
+#define EFFECT_DELAY "delay"
+#define EFFECT_REVERB "reverb"
+#define EFFECT_LIMITER "limiter"
+
+// Filter types
+#define FILTER_LOWPASS "lowpass"
+#define FILTER_HIGHPASS "highpass"
+#define FILTER_BANDPASS "bandpass"
+
+// Delay modes and interpolations
+#define DELAY_MODE_ECHO "echo"
+#define DELAY_MODE_CHORUS "chorus"
+#define DELAY_MODE_FLANGER "flanger"
+#define DELAY_INTERPOLATION_LINEAR "linear"
+#define DELAY_INTERPOLATION_ALLPASS "allpass"
+
+// Shapes of low frequency oscillators
+#define LFO_SINE "sine"
+#define LFO_TRIANGLE "triangle"
+#define LFO_RANDOM "random"
+
+// Actions which can be triggered
+static const char* ACTION_NAMES[] = {
+    ACTION_SUSTAIN_NOTE,
+    ACTION_OCTAVE_UP,
+    ACTION_CHANGE_WAVEFORM,
+    ACTION_AUTOTUNE_NONE,
+    ACTION_AUTOTUNE_SMOOTH,
+    ACTION_AUTOTUNE_FULL,
+    ACTION_TREMOLO,
+    ACTION_VIBRATO,
+    ACTION_RECORDING_REPLAYING,
+    ACTION_CHORD_MAJOR_1,
+    ACTION_CHORD_MAJOR_3,
+    ACTION_CHORD_MAJOR_5,
+    ACTION_CHORD_MINOR_1,
+    ACTION_CHORD_MINOR_3,
+    ACTION_CHORD_MINOR_5,
+    ACTION_CHORD_CLEAR,
+    ACTION_DUMP_TIMELINE
+};
 
 // Implemented waveforms
 #define WAVE_SIN "sin"
@@ -71,6 +230,12 @@
 #define WAVE_SAW "saw"
 #define WAVE_SQUARE "square"
 #define WAVE_COMPLEX "complex"
+#define WAVE_MORPH "morph"
+
+// Oscillators for the waveforms with discontinuities: evaluated as is,
+// or with polynomial corrections against aliasing
+#define OSCILLATOR_NAIVE "naive"
+#define OSCILLATOR_POLYBLEP "polyblep"
 
 static const char* WAVE_NAMES[] = {
     WAVE_SIN,
@@ -83,92 +248,34 @@ static const char* WAVE_NAMES[] = {
     WAVE_GAUSS,
     WAVE_SAW,
     WAVE_SQUARE,
-    WAVE_COMPLEX
+    WAVE_COMPLEX,
+    WAVE_MORPH
 };
 
-// note frequencies
-#define  C_0    130.8127826502992
-#define  CIS_0  138.59131548843592
-#define  D_0    146.83238395870364
-#define  DIS_0  155.56349186104032
-#define  E_0    164.81377845643482
-#define  F_0    174.6141157165018
-#define  FIS_0  184.99721135581706
-#define  G_0    195.9977179908745
-#define  GIS_0  207.65234878997242
-#define  A_0    219.99999999999986
-#define  AIS_0  233.08188075904482
-#define  B_0    246.94165062806192
-#define  C_1    261.6255653005985
-#define  CIS_1  277.18263097687196
-#define  D_1    293.66476791740746
-#define  DIS_1  311.1269837220808
-#define  E_1    329.62755691286986
-#define  F_1    349.2282314330038
-#define  FIS_1  369.99442271163434
-#define  G_1    391.99543598174927
-#define  GIS_1  415.3046975799451
-#define  A_1    440.0
-#define  AIS_1  466.1637615180899
-#define  B_1    493.8833012561241
-#define  C_2    523.2511306011974
-#define  CIS_2  554.3652619537443
-#define  D_2    587.3295358348153
-#define  DIS_2  622.253967444162
-#define  E_2    659.2551138257401
-#define  F_2    698.456462866008
-#define  FIS_2  739.988845423269
-#define  G_2    783.9908719634989
-#define  GIS_2  830.6093951598906
-#define  A_2    880.0000000000003
-#define  AIS_2  932.3275230361802
-#define  B_2    987.7666025122486
-#define  C_3    1046.502261202395
-#define  CIS_3  1108.7305239074888
-#define  D_3    1174.6590716696307
-#define  DIS_3  1244.5079348883241
-#define  E_3    1318.5102276514804
-#define  F_3    1396.9129257320162
-#define  FIS_3  1479.9776908465383
-#define  G_3    1567.981743926998
-#define  GIS_3  1661.2187903197814
-#define  A_3    1760.000000000001
-#define  AIS_3  1864.6550460723606
-#define  B_3    1975.5332050244976
-#define  C_4    2093.0045224047904
-#define  CIS_4  2217.4610478149784
-#define  D_4    2349.3181433392624
-#define  DIS_4  2489.0158697766497
-#define  E_4    2637.020455302962
-#define  F_4    2793.825851464034
-#define  FIS_4  2959.9553816930784
-#define  G_4    3135.963487853998
-#define  GIS_4  3322.4375806395647
-#define  A_4    3520.000000000004
-#define  AIS_4  3729.310092144724
-#define  B_4    3951.066410048998
-#define  C_5    4186.009044809583
-#define  CIS_5  4434.92209562996
-#define  D_5    4698.6362866785275
-#define  DIS_5  4978.031739553302
-#define  E_5    5274.040910605927
-#define  F_5    5587.651702928071
-#define  FIS_5  5919.91076338616
-#define  G_5    6271.926975707999
-#define  GIS_5  6644.875161279134
-#define  A_5    7040.000000000013
-#define  AIS_5  7458.6201842894525
-#define  B_5    7902.132820098001
-#define  C_6    8372.018089619172
-
-static const double NOTES[] = {C_0,CIS_0,D_0,DIS_0,E_0,F_0,FIS_0,G_0,GIS_0,A_0,AIS_0,B_0,C_1,CIS_1,D_1,DIS_1,E_1,F_1,FIS_1,G_1,GIS_1,A_1,AIS_1,B_1,C_2,CIS_2,D_2,DIS_2,E_2,F_2,FIS_2,G_2,GIS_2,A_2,AIS_2,B_2,C_3,CIS_3,D_3,DIS_3,E_3,F_3,FIS_3,G_3,GIS_3,A_3,AIS_3,B_3,C_4,CIS_4,D_4,DIS_4,E_4,F_4,FIS_4,G_4,GIS_4,A_4,AIS_4,B_4,C_5,CIS_5,D_5,DIS_5,E_5,F_5,FIS_5,G_5,GIS_5,A_5,AIS_5,B_5,C_6};
+// Names of the notes, whose frequencies are given by the Tuning
+// of an instrument
 static const char* NOTE_NAMES[] = {"c0","c#0","d0","d#0","e0","f0","f#0","g0","g#0","a0","a#0","b0","c1","c#1","d1","d#1","e1","f1","f#1","g1","g#1","a1","a#1","b1","c2","c#2","d2","d#2","e2","f2","f#2","g2","g#2","a2","a#2","b2","c3","c#3","d3","d#3","e3","f3","f#3","g3","g#3","a3","a#3","b3","c4","c#4","d4","d#4","e4","f4","f#4","g4","g#4","a4","a#4","b4","c5","c#5","d5","d#5","e5","f5","f#5","g5","g#5","a5","a#5","b5","c6"};
 
+// Distance curves simulated by the mock brickd
+#define MOCK_CURVE_SINE "sine"
+#define MOCK_CURVE_RAMP "ramp"
+#define MOCK_CURVE_CONSTANT "constant"
+
+// Tuning of the equal temperament (any other tuning is a Scala file)
+#define TUNING_EQUAL "equal"
+
 // Autotune modes
 #define AUTOTUNE_NONE "none"
 #define AUTOTUNE_SMOOTH "smooth"
 #define AUTOTUNE_FULL "full"
 
+// Autotune scales
+#define SCALE_CHROMATIC "chromatic"
+#define SCALE_MAJOR "major"
+#define SCALE_MINOR "minor"
+#define SCALE_PENTATONIC "pentatonic"
+#define SCALE_CUSTOM "custom"
+
 #define CHORD_MODE_1 1
 #define CHORD_MODE_3 3
 #define CHORD_MODE_5 5
@@ -0,0 +1,444 @@
+#include <iostream>
+#include <cmath>
+#include <cstring>
+
+#include "const.h"
+#include "effects.hpp"
+
+static float db_to_gain(float db) {
+    return std::pow(10.0f, db / 20);
+}
+
+/*
+ * Gain
+ */
+
+void GainEffect::setup(Configuration* cfg, double sampleRate, int maxBlockSize) {
+    gain = targetGain = db_to_gain(cfg->d(GAIN_DB));
+}
+
+void GainEffect::process(float* block, int size) {
+
+    float step = (targetGain - gain) / size;
+    for (int i = 0; i < size; i++) {
+        gain += step;
+        block[i] *= gain;
+    }
+    gain = targetGain;
+}
+
+void GainEffect::set_parameter(int param, float value) {
+    if (param == PARAM_GAIN_DB) {
+        targetGain = db_to_gain(value);
+    }
+}
+
+/*
+ * Tremolo
+ */
+
+void TremoloEffect::setup(Configuration* cfg, double sampleRate, int maxBlockSize) {
+
+    enabled = cfg->b(TREMOLO_ENABLED);
+    lfo.setup(sampleRate, cfg->str(TREMOLO_SHAPE),
+              Lfo::frequency(cfg, TREMOLO_FREQUENCY, TREMOLO_SYNC_BEATS));
+    set_parameter(PARAM_INTENSITY, cfg->d(TREMOLO_INTENSITY));
+    if (enabled) {
+        lfo.start();
+    }
+}
+
+void TremoloEffect::process(float* block, int size) {
+
+    for (int i = 0; i < size; i++) {
+        lfo.tick();
+        block[i] *= 1 + intensity * lfo.value();
+    }
+}
+
+void TremoloEffect::set_parameter(int param, float value) {
+
+    if (param == PARAM_FREQUENCY) {
+        lfo.set_frequency(value);
+    } else if (param == PARAM_INTENSITY) {
+        intensity = value;
+    } else if (param == EffectsChain::PARAM_ENABLED) {
+        // Start the modulation with the original volume, and
+        // stop it there (or continue it if it is stopping)
+        if (value != 0) {
+            lfo.start();
+        } else {
+            lfo.stop();
+        }
+    }
+}
+
+bool TremoloEffect::is_winding_down() {
+    return lfo.is_active();
+}
+
+/*
+ * Filter
+ */
+
+void FilterEffect::setup(Configuration* cfg, double sampleRate, int maxBlockSize) {
+
+    this->sampleRate = sampleRate;
+    enabled = cfg->b(FILTER_ENABLED);
+    type = cfg->str(FILTER_TYPE);
+    if (type != FILTER_LOWPASS && type != FILTER_HIGHPASS
+            && type != FILTER_BANDPASS) {
+        std::cerr << "Error: Unknown filter type \"" << type << "\"." << std::endl;
+        exit(1);
+    }
+    cutoff = cfg->d(FILTER_CUTOFF);
+    resonance = cfg->d(FILTER_RESONANCE);
+    update_coefficients(cutoff);
+
+    lfo.setup(sampleRate, cfg->str(FILTER_LFO_SHAPE),
+              Lfo::frequency(cfg, FILTER_LFO_FREQUENCY, FILTER_LFO_SYNC_BEATS));
+    set_parameter(PARAM_LFO_DEPTH, cfg->d(FILTER_LFO_DEPTH));
+}
+
+void FilterEffect::process(float* block, int size) {
+
+    for (int i = 0; i < size; i++) {
+        if (lfo.tick() && (lfo.is_active() || swept)) {
+            // Also restores the original cutoff once the sweep is over
+            update_coefficients(cutoff * std::exp2(lfoDepth * lfo.value()));
+            swept = lfo.is_active();
+        }
+        float in = block[i];
+        float out = b0 * in + z1;
+        z1 = b1 * in - a1 * out + z2;
+        z2 = b2 * in - a2 * out;
+        block[i] = out;
+    }
+}
+
+void FilterEffect::set_parameter(int param, float value) {
+
+    if (param == PARAM_CUTOFF) {
+        cutoff = value;
+    } else if (param == PARAM_RESONANCE) {
+        resonance = value;
+    } else if (param == PARAM_LFO_FREQUENCY) {
+        lfo.set_frequency(value);
+        return;
+    } else if (param == PARAM_LFO_DEPTH) {
+        // Sweep as long as there is a depth, and stop
+        // at the original cutoff otherwise
+        if (value == 0) {
+            lfo.stop();
+        } else {
+            lfoDepth = value;
+            if (!lfo.is_running()) {
+                lfo.start();
+            }
+        }
+        return;
+    } else {
+        return;
+    }
+    update_coefficients(cutoff);
+}
+
+void FilterEffect::update_coefficients(double cutoff) {
+
+    // Keep the cutoff below the Nyquist frequency
+    double f = std::min(std::max(cutoff, 1.0), 0.49 * sampleRate);
+    double q = std::max(resonance, 0.01);
+    double w0 = 2 * M_PI * f / sampleRate;
+    double alpha = std::sin(w0) / (2 * q);
+    double cosW0 = std::cos(w0);
+
+    double nb0, nb1, nb2;
+    if (type == FILTER_LOWPASS) {
+        nb0 = (1 - cosW0) / 2;
+        nb1 = 1 - cosW0;
+        nb2 = (1 - cosW0) / 2;
+    } else if (type == FILTER_HIGHPASS) {
+        nb0 = (1 + cosW0) / 2;
+        nb1 = -(1 + cosW0);
+        nb2 = (1 + cosW0) / 2;
+    } else {
+        nb0 = alpha;
+        nb1 = 0;
+        nb2 = -alpha;
+    }
+    double a0 = 1 + alpha;
+    b0 = nb0 / a0;
+    b1 = nb1 / a0;
+    b2 = nb2 / a0;
+    a1 = -2 * cosW0 / a0;
+    a2 = (1 - alpha) / a0;
+}
+
+/*
+ * Delay
+ */
+
+static int next_power_of_two(int n) {
+    int power = 1;
+    while (power < n) {
+        power *= 2;
+    }
+    return power;
+}
+
+void DelayEffect::setup(Configuration* cfg, double sampleRate, int maxBlockSize) {
+
+    this->sampleRate = sampleRate;
+    enabled = cfg->b(DELAY_ENABLED);
+
+    mode = cfg->str(DELAY_MODE);
+    if (mode != DELAY_MODE_ECHO && mode != DELAY_MODE_CHORUS
+            && mode != DELAY_MODE_FLANGER) {
+        std::cerr << "Error: Unknown delay mode \"" << mode << "\"." << std::endl;
+        exit(1);
+    }
+    numVoices = (mode == DELAY_MODE_CHORUS ? 2 : 1);
+    allpass = (cfg->str(DELAY_INTERPOLATION) == DELAY_INTERPOLATION_ALLPASS);
+
+    int length = next_power_of_two(MAX_SECONDS * sampleRate + 2);
+    line.assign(length, 0);
+    mask = length - 1;
+
+    modulation.setup(sampleRate, LFO_SINE, 0);
+    modulation.start();
+    set_parameter(PARAM_TIME, cfg->d(DELAY_TIME));
+    set_parameter(PARAM_FEEDBACK, cfg->d(DELAY_FEEDBACK));
+    set_parameter(PARAM_MIX, cfg->d(DELAY_MIX));
+    set_parameter(PARAM_MOD_RATE, cfg->d(DELAY_MOD_RATE));
+    set_parameter(PARAM_MOD_DEPTH, cfg->d(DELAY_MOD_DEPTH));
+    delayTime = targetDelayTime;
+}
+
+void DelayEffect::process(float* block, int size) {
+
+    // Glide over about 20ms when the delay time changes
+    float glide = 1 - std::exp(-1 / (0.02f * sampleRate));
+    float maxDelay = mask - 2;
+
+    for (int i = 0; i < size; i++) {
+
+        delayTime += glide * (targetDelayTime - delayTime);
+        modulation.tick();
+        float offset = modDepth * modulation.value();
+
+        float wet = 0;
+        for (int voice = 0; voice < numVoices; voice++) {
+            // Voices are modulated in opposite phase
+            float delay = delayTime + (voice == 0 ? offset : -offset);
+            delay = std::min(std::max(delay, 1.0f), maxDelay);
+            wet += read(delay, voice);
+        }
+        wet /= numVoices;
+
+        line[writeIdx] = block[i] + feedback * wet;
+        block[i] = (1 - mix) * block[i] + mix * wet;
+
+        writeIdx = (writeIdx + 1) & mask;
+    }
+}
+
+/*
+ * Reads the line the given (fractional) amount of samples
+ * behind the position which is written next.
+ */
+float DelayEffect::read(float delay, int voice) {
+
+    int whole = (int) delay;
+    float fraction = delay - whole;
+
+    if (!allpass) {
+        float newer = line[(writeIdx - whole) & mask];
+        float older = line[(writeIdx - whole - 1) & mask];
+        return newer + fraction * (older - newer);
+    }
+
+    // First-order allpass, which is best conditioned for
+    // fractions within [0.1, 1.1)
+    if (fraction < 0.1f && whole > 1) {
+        whole--;
+        fraction += 1;
+    }
+    float coefficient = (1 - fraction) / (1 + fraction);
+    float newer = line[(writeIdx - whole) & mask];
+    float older = line[(writeIdx - whole - 1) & mask];
+    float out = coefficient * newer + older - coefficient * allpassState[voice];
+    allpassState[voice] = out;
+    return out;
+}
+
+void DelayEffect::set_parameter(int param, float value) {
+
+    if (param == PARAM_TIME) {
+        // Time in milliseconds
+        targetDelayTime = std::min(std::max(value / 1000 * sampleRate, 1.0), 
+                                   MAX_SECONDS * sampleRate);
+    } else if (param == PARAM_FEEDBACK) {
+        // A chorus has no feedback, a flanger may invert it
+        if (mode == DELAY_MODE_CHORUS) {
+            feedback = 0;
+        } else if (mode == DELAY_MODE_FLANGER) {
+            feedback = std::min(std::max(value, -0.95f), 0.95f);
+        } else {
+            feedback = std::min(std::max(value, 0.0f), 0.99f);
+        }
+    } else if (param == PARAM_MIX) {
+        mix = std::min(std::max(value, 0.0f), 1.0f);
+    } else if (param == PARAM_MOD_RATE) {
+        modulation.set_frequency(value);
+    } else if (param == PARAM_MOD_DEPTH) {
+        // Depth in milliseconds
+        modDepth = std::max(value, 0.0f) / 1000 * sampleRate;
+    }
+}
+
+/*
+ * Reverb
+ */
+
+// Lengths of the delay lines at 48 kHz and a room size of 1
+static const int REVERB_LENGTHS[] = {1433, 1601, 1867, 2053, 2251, 2399, 2617, 2801};
+
+void ReverbEffect::setup(Configuration* cfg, double sampleRate, int maxBlockSize) {
+
+    this->sampleRate = sampleRate;
+    enabled = cfg->b(REVERB_ENABLED);
+
+    int maxLength = 0;
+    double scale = cfg->d(REVERB_SIZE) * sampleRate / 48000;
+    for (int i = 0; i < NUM_LINES; i++) {
+        lengths[i] = std::max(1, (int) (REVERB_LENGTHS[i] * scale));
+        maxLength = std::max(maxLength, lengths[i]);
+    }
+    int numFrames = next_power_of_two(maxLength + 1);
+    lines.assign(numFrames * NUM_LINES, 0);
+    frameMask = numFrames - 1;
+
+    int preDelayLength = next_power_of_two(MAX_PREDELAY_SECONDS * sampleRate + 1);
+    preDelayLine.assign(preDelayLength, 0);
+    preDelayMask = preDelayLength - 1;
+
+    for (int i = 0; i < NUM_LINES; i++) {
+        lowpass[i] = 0;
+    }
+    set_parameter(PARAM_TIME, cfg->d(REVERB_TIME));
+    set_parameter(PARAM_DAMPING, cfg->d(REVERB_DAMPING));
+    set_parameter(PARAM_PREDELAY, cfg->d(REVERB_PREDELAY));
+    set_parameter(PARAM_MIX, cfg->d(REVERB_MIX));
+}
+
+void ReverbEffect::process(float* block, int size) {
+
+    // Output taps alternate in sign to decorrelate the lines
+    const Lanes signs = {1, -1, 1, -1};
+    const float outputGain = 1 / std::sqrt((float) NUM_LINES);
+    const float householder = 2.0f / NUM_LINES;
+
+    Lanes decayA, decayB, lowpassA, lowpassB;
+    memcpy(&decayA, decay, sizeof(decayA));
+    memcpy(&decayB, decay + 4, sizeof(decayB));
+    memcpy(&lowpassA, lowpass, sizeof(lowpassA));
+    memcpy(&lowpassB, lowpass + 4, sizeof(lowpassB));
+
+    for (int i = 0; i < size; i++) {
+
+        // Pre-delay
+        preDelayLine[preDelayWriteIdx] = block[i];
+        float in = preDelayLine[(preDelayWriteIdx - preDelaySamples) & preDelayMask];
+        preDelayWriteIdx = (preDelayWriteIdx + 1) & preDelayMask;
+
+        // Outputs of the lines
+        float out[NUM_LINES];
+        for (int j = 0; j < NUM_LINES; j++) {
+            int frame = (writeIdx - lengths[j]) & frameMask;
+            out[j] = lines[frame * NUM_LINES + j];
+        }
+        Lanes a, b;
+        memcpy(&a, out, sizeof(a));
+        memcpy(&b, out + 4, sizeof(b));
+
+        // Damping and decay
+        lowpassA += damping * (a - lowpassA);
+        lowpassB += damping * (b - lowpassB);
+        a = lowpassA * decayA;
+        b = lowpassB * decayB;
+
+        Lanes wet = (a + b) * signs;
+        float wetSum = wet[0] + wet[1] + wet[2] + wet[3];
+
+        // Householder mixing: reflect at the diagonal, then feed the input
+        Lanes sum = a + b;
+        float feedback = householder * (sum[0] + sum[1] + sum[2] + sum[3]);
+        a = a - feedback + in;
+        b = b - feedback + in;
+        memcpy(&lines[writeIdx * NUM_LINES], &a, sizeof(a));
+        memcpy(&lines[writeIdx * NUM_LINES + 4], &b, sizeof(b));
+        writeIdx = (writeIdx + 1) & frameMask;
+
+        block[i] = (1 - mix) * block[i] + mix * outputGain * wetSum;
+    }
+
+    memcpy(lowpass, &lowpassA, sizeof(lowpassA));
+    memcpy(lowpass + 4, &lowpassB, sizeof(lowpassB));
+}
+
+void ReverbEffect::set_parameter(int param, float value) {
+
+    if (param == PARAM_TIME) {
+        // Decay of each line such that the reverb decays
+        // by 60 dB within the given amount of seconds
+        for (int i = 0; i < NUM_LINES; i++) {
+            decay[i] = std::pow(10.0, -3.0 * lengths[i] 
+                    / (std::max(value, 0.01f) * sampleRate));
+        }
+    } else if (param == PARAM_DAMPING) {
+        // Coefficient of the low passes: 1 does not damp at all
+        damping = 1 - 0.95f * std::min(std::max(value, 0.0f), 1.0f);
+    } else if (param == PARAM_PREDELAY) {
+        // Pre-delay in milliseconds
+        preDelaySamples = (int) (value / 1000 * sampleRate);
+        preDelaySamples = std::min(std::max(preDelaySamples, 0), preDelayMask);
+    } else if (param == PARAM_MIX) {
+        mix = std::min(std::max(value, 0.0f), 1.0f);
+    }
+}
+
+/*
+ * Limiter
+ */
+
+void LimiterEffect::setup(Configuration* cfg, double sampleRate, int maxBlockSize) {
+
+    this->sampleRate = sampleRate;
+    set_parameter(PARAM_THRESHOLD, cfg->d(LIMITER_THRESHOLD));
+    set_parameter(PARAM_RELEASE, cfg->d(LIMITER_RELEASE));
+}
+
+void LimiterEffect::process(float* block, int size) {
+
+    for (int i = 0; i < size; i++) {
+        float level = std::abs(block[i]);
+        if (level > envelope) {
+            envelope = level;
+        } else {
+            envelope = level + releaseFactor * (envelope - level);
+        }
+        if (envelope > threshold) {
+            block[i] *= threshold / envelope;
+        }
+    }
+}
+
+void LimiterEffect::set_parameter(int param, float value) {
+
+    if (param == PARAM_THRESHOLD) {
+        threshold = std::max(value, 0.001f);
+    } else if (param == PARAM_RELEASE) {
+        // Release time in milliseconds until the envelope has decayed to 1/e
+        releaseFactor = std::exp(-1000 / (std::max(value, 0.1f) * sampleRate));
+    }
+}
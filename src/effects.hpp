@@ -0,0 +1,184 @@
+#ifndef THEREMIN_EFFECTS_H
+#define THEREMIN_EFFECTS_H
+
+#include <vector>
+
+#include "configuration.hpp"
+#include "effects_chain.hpp"
+#include "lfo.hpp"
+
+/*
+ * Amplifies or attenuates the signal. Changes of the gain
+ * are ramped over a block to avoid zipper noise.
+ */
+class GainEffect : public Effect {
+
+public:
+    enum { PARAM_GAIN_DB };
+
+    void setup(Configuration* cfg, double sampleRate, int maxBlockSize);
+    void process(float* block, int size);
+    void set_parameter(int param, float value);
+
+private:
+    float gain;
+    float targetGain;
+};
+
+/*
+ * Modulates the amplitude of the signal with an LFO.
+ */
+class TremoloEffect : public Effect {
+
+public:
+    enum { PARAM_FREQUENCY, PARAM_INTENSITY };
+
+    void setup(Configuration* cfg, double sampleRate, int maxBlockSize);
+    void process(float* block, int size);
+    void set_parameter(int param, float value);
+    bool is_winding_down();
+
+private:
+    Lfo lfo;
+    float intensity;
+};
+
+/*
+ * A biquad filter (low pass, high pass or band pass) after the
+ * formulas of the Audio EQ Cookbook by Robert Bristow-Johnson.
+ * The cutoff may be swept by an LFO, in which case the coefficients
+ * are recomputed once per control block of the LFO.
+ */
+class FilterEffect : public Effect {
+
+public:
+    enum { PARAM_CUTOFF, PARAM_RESONANCE, PARAM_LFO_FREQUENCY, PARAM_LFO_DEPTH };
+
+    void setup(Configuration* cfg, double sampleRate, int maxBlockSize);
+    void process(float* block, int size);
+    void set_parameter(int param, float value);
+
+private:
+    void update_coefficients(double cutoff);
+
+    std::string type;
+    double sampleRate;
+    double cutoff;
+    double resonance;
+
+    Lfo lfo;
+    float lfoDepth = 0; // in octaves
+    bool swept = false;
+
+    // Normalized coefficients and state (transposed direct form II)
+    float b0, b1, b2, a1, a2;
+    float z1 = 0, z2 = 0;
+};
+
+/*
+ * A delay line whose read head is modulated by a sine LFO and read at
+ * fractional positions (linear or allpass interpolation). Depending on
+ * the mode, it acts as a feedback echo, as a two-voice chorus without
+ * feedback, or as a flanger with (possibly negative) feedback.
+ * The memory for the longest delay is allocated once at setup.
+ */
+class DelayEffect : public Effect {
+
+public:
+    enum { PARAM_TIME, PARAM_FEEDBACK, PARAM_MIX, PARAM_MOD_RATE, PARAM_MOD_DEPTH };
+
+    void setup(Configuration* cfg, double sampleRate, int maxBlockSize);
+    void process(float* block, int size);
+    void set_parameter(int param, float value);
+
+private:
+    static constexpr double MAX_SECONDS = 2.0;
+    static const int MAX_VOICES = 2;
+
+    float read(float delay, int voice);
+
+    std::string mode;
+    bool allpass;
+    int numVoices;
+    double sampleRate;
+
+    std::vector<float> line;
+    int mask;
+    int writeIdx = 0;
+
+    // Delay times in samples; the current time glides towards the target
+    float delayTime = 0;
+    float targetDelayTime;
+    float modDepth;
+    Lfo modulation;
+    float feedback;
+    float mix;
+
+    // Last outputs of the allpass interpolators
+    float allpassState[MAX_VOICES] = {0, 0};
+};
+
+/*
+ * A feedback delay network reverb: eight delay lines of unrelated
+ * lengths, fed by a pre-delay and mixed by a Householder
+ * matrix, each with a low pass in its feedback path to damp the
+ * high frequencies. The lines are processed as SIMD vectors of four.
+ */
+class ReverbEffect : public Effect {
+
+public:
+    enum { PARAM_TIME, PARAM_DAMPING, PARAM_PREDELAY, PARAM_MIX };
+
+    void setup(Configuration* cfg, double sampleRate, int maxBlockSize);
+    void process(float* block, int size);
+    void set_parameter(int param, float value);
+
+private:
+    typedef float Lanes __attribute__((vector_size(16)));
+    static const int NUM_LINES = 8;
+    static constexpr double MAX_PREDELAY_SECONDS = 0.5;
+
+    double sampleRate;
+
+    // Frames of all lines, interleaved: one frame holds one sample of each
+    // line, such that a frame can be written at once. Each line reads at
+    // its own distance behind the common write position.
+    std::vector<float> lines;
+    int frameMask;
+    int writeIdx = 0;
+    int lengths[NUM_LINES];
+
+    // Kept as plain floats, as allocations need not be aligned for SIMD
+    float decay[NUM_LINES];
+    float lowpass[NUM_LINES];
+    float damping;
+    float mix;
+
+    std::vector<float> preDelayLine;
+    int preDelayMask;
+    int preDelayWriteIdx = 0;
+    int preDelaySamples;
+};
+
+/*
+ * Keeps the peaks of the signal below a threshold: the gain drops
+ * instantly whenever a peak exceeds it and recovers with the
+ * configured release time.
+ */
+class LimiterEffect : public Effect {
+
+public:
+    enum { PARAM_THRESHOLD, PARAM_RELEASE };
+
+    void setup(Configuration* cfg, double sampleRate, int maxBlockSize);
+    void process(float* block, int size);
+    void set_parameter(int param, float value);
+
+private:
+    double sampleRate;
+    float threshold;
+    float releaseFactor;
+    float envelope = 0;
+};
+
+#endif
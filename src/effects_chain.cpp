@@ -0,0 +1,177 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "const.h"
+#include "effects_chain.hpp"
+#include "effects.hpp"
+
+// Cutoff of the DC blocker, far below the lowest playable note
+#define DC_BLOCKER_HZ 10.0
+
+EffectsChain::~EffectsChain() {
+    for (int i = 0; i < effects.size(); i++) {
+        delete effects[i];
+    }
+}
+
+/*
+ * Creates and sets up all effects of the configuration, in order.
+ * Blocks to be processed may hold up to maxBlockSize samples.
+ */
+void EffectsChain::setup(Configuration* cfg, int maxBlockSize) {
+
+    changesWritten = 0;
+    changesRead = 0;
+    dry.resize(maxBlockSize);
+    dcCoefficient = std::exp(-2 * M_PI * DC_BLOCKER_HZ / cfg->i(SAMPLE_RATE));
+
+    for (int i = 0; i < cfg->num_entries(EFFECTS); i++) {
+
+        Configuration* effectCfg = cfg->entry(EFFECTS, i);
+        std::string type = effectCfg->str(EFFECT_TYPE);
+        Effect* effect = create(type);
+        effect->setup(effectCfg, cfg->i(SAMPLE_RATE), maxBlockSize);
+        delete effectCfg;
+
+        effects.push_back(effect);
+        types.push_back(type);
+        requested.push_back(effect->enabled);
+        active.push_back(effect->enabled);
+        processed.push_back(effect->enabled);
+    }
+}
+
+Effect* EffectsChain::create(std::string type) {
+
+    if (type == EFFECT_GAIN) {
+        return new GainEffect();
+    } else if (type == EFFECT_TREMOLO) {
+        return new TremoloEffect();
+    } else if (type == EFFECT_FILTER) {
+        return new FilterEffect();
+    } else if (type == EFFECT_DELAY) {
+        return new DelayEffect();
+    } else if (type == EFFECT_REVERB) {
+        return new ReverbEffect();
+    } else if (type == EFFECT_LIMITER) {
+        return new LimiterEffect();
+    }
+    std::cerr << "Error: Unknown effect \"" << type << "\"." << std::endl;
+    exit(1);
+}
+
+/*
+ * Removes the offset of the given block and applies
+ * all active effects to it, in place.
+ */
+void EffectsChain::process(float* block, int size) {
+
+    apply_changes();
+
+    for (int i = 0; i < size; i++) {
+        dcOutput = block[i] - dcInput + dcCoefficient * dcOutput;
+        dcInput = block[i];
+        block[i] = dcOutput;
+    }
+
+    for (int i = 0; i < effects.size(); i++) {
+
+        if (!active[i] && !processed[i]) {
+            continue;
+        }
+        if (active[i] == processed[i]
+                || (processed[i] && effects[i]->is_winding_down())) {
+            effects[i]->process(block, size);
+            continue;
+        }
+
+        // Fade the effect in or out over this block
+        std::copy(block, block + size, dry.begin());
+        effects[i]->process(block, size);
+        for (int j = 0; j < size; j++) {
+            float share = (j + 1) / (float) size;
+            if (!active[i]) {
+                share = 1 - share;
+            }
+            block[j] = dry[j] + share * (block[j] - dry[j]);
+        }
+        processed[i] = active[i];
+    }
+}
+
+int EffectsChain::size() {
+    return effects.size();
+}
+
+/*
+ * Returns the index of the first effect of the given type,
+ * or -1 if there is none.
+ */
+int EffectsChain::find(std::string type) {
+
+    for (int i = 0; i < types.size(); i++) {
+        if (types[i] == type) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Requests a change of a parameter of an effect, to be applied before
+ * the next block. Must always be called from the same thread.
+ */
+void EffectsChain::post(int effectIdx, int param, float value) {
+
+    if (param == PARAM_ENABLED) {
+        requested[effectIdx] = (value != 0);
+    }
+
+    unsigned int written = changesWritten.load(std::memory_order_relaxed);
+    if (written - changesRead.load(std::memory_order_acquire) >= CHANGE_RING_SIZE) {
+        // The audio path did not keep up, drop the change
+        return;
+    }
+    changeRing[written % CHANGE_RING_SIZE] = {effectIdx, param, value};
+    changesWritten.store(written + 1, std::memory_order_release);
+}
+
+/*
+ * Enables or disables all effects of the given type.
+ */
+void EffectsChain::set_enabled(std::string type, bool enabled) {
+
+    for (int i = 0; i < types.size(); i++) {
+        if (types[i] == type) {
+            post(i, PARAM_ENABLED, enabled);
+        }
+    }
+}
+
+/*
+ * True if an effect of the given type is (requested to be) enabled.
+ */
+bool EffectsChain::is_enabled(std::string type) {
+
+    for (int i = 0; i < types.size(); i++) {
+        if (types[i] == type && requested[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EffectsChain::apply_changes() {
+
+    unsigned int read = changesRead.load(std::memory_order_relaxed);
+    unsigned int written = changesWritten.load(std::memory_order_acquire);
+    for (; read != written; read++) {
+        const Change& change = changeRing[read % CHANGE_RING_SIZE];
+        if (change.param == PARAM_ENABLED) {
+            active[change.effectIdx] = (change.value != 0);
+        }
+        effects[change.effectIdx]->set_parameter(change.param, change.value);
+    }
+    changesRead.store(read, std::memory_order_release);
+}
@@ -0,0 +1,96 @@
+#ifndef THEREMIN_EFFECTS_CHAIN_H
+#define THEREMIN_EFFECTS_CHAIN_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "configuration.hpp"
+
+/*
+ * A processor of the effects chain. Blocks of samples are processed in
+ * place; all memory must be allocated in setup(), such that process()
+ * and set_parameter() are safe to call from the audio path.
+ */
+class Effect {
+
+public:
+    virtual ~Effect() {}
+
+    virtual void setup(Configuration* cfg, double sampleRate, int maxBlockSize) = 0;
+    virtual void process(float* block, int size) = 0;
+    virtual void set_parameter(int param, float value) {}
+
+    // True while the effect, though disabled, is still winding down
+    // (e.g. its modulation returning to rest) and must be processed
+    virtual bool is_winding_down() { return false; }
+
+    // Initial state as read from the configuration
+    bool enabled = true;
+};
+
+/*
+ * The ordered list of effects configured with the "effects" setting,
+ * applied to each block of the mixed output. The synthesizer renders
+ * values within [0, volume], so the offset of the mix is removed by a
+ * DC blocker first: the effects (and the output) get a bipolar signal,
+ * and the feedback of the delay and the reverb does not pile up an
+ * offset. Parameter changes and
+ * (de)activations are posted from the controlling thread through a
+ * lock-free queue and take effect at the start of the next block;
+ * (de)activations are crossfaded over a single block, deactivations
+ * only once the effect has wound down.
+ */
+class EffectsChain {
+
+public:
+    // Parameter understood by all effects (value 0 or 1)
+    static const int PARAM_ENABLED = -1;
+
+    ~EffectsChain();
+
+    void setup(Configuration* cfg, int maxBlockSize);
+    void process(float* block, int size);
+
+    int size();
+    int find(std::string type);
+    void post(int effectIdx, int param, float value);
+
+    void set_enabled(std::string type, bool enabled);
+    bool is_enabled(std::string type);
+
+private:
+    struct Change {
+        int effectIdx;
+        int param;
+        float value;
+    };
+
+    static Effect* create(std::string type);
+    void apply_changes();
+
+    std::vector<Effect*> effects;
+    std::vector<std::string> types;
+
+    // State of the effects as last requested by the controlling thread,
+    // as seen by the audio path, and as of the last processed block
+    std::vector<bool> requested;
+    std::vector<bool> active;
+    std::vector<bool> processed;
+
+    // Unprocessed copy of a block to crossfade with
+    std::vector<float> dry;
+
+    // One-pole high pass removing the offset of the input
+    float dcCoefficient;
+    float dcInput = 0;
+    float dcOutput = 0;
+
+    // Single-producer, single-consumer ring of parameter changes
+    static const int CHANGE_RING_SIZE = 256;
+    Change changeRing[CHANGE_RING_SIZE];
+    std::atomic<unsigned int> changesWritten;
+    std::atomic<unsigned int> changesRead;
+};
+
+#endif
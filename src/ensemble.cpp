@@ -0,0 +1,198 @@
+#include <iostream>
+#include <algorithm>
+
+#include "const.h"
+#include "ensemble.hpp"
+#include "realtime.hpp"
+#include "rt_audit.hpp"
+#include "timeline.hpp"
+
+/*
+ * Creates all instruments listed in the configuration, registers
+ * their input devices at the given input thread and launches one
+ * rendering thread per instrument.
+ */
+void Ensemble::setup(Configuration* cfg, InputThread* inputThread) {
+
+    this->inputThread = inputThread;
+    blockSize = cfg->i(BUFFER_SIZE);
+    realtime = cfg->b(REALTIME_ENABLED);
+    int numCores = std::thread::hardware_concurrency();
+
+    for (int i = 0; i < cfg->num_entries(ENSEMBLE); i++) {
+
+        Instrument* instrument = new Instrument();
+        instrument->cfg = cfg->entry(ENSEMBLE, i);
+        instrument->index = i;
+        instrument->gain = instrument->cfg->d(INSTRUMENT_GAIN);
+
+        // All instruments share the wavetables of the process
+        if (instrument->cfg->str(WAVETABLE_DIR) != cfg->str(WAVETABLE_DIR)
+                || instrument->cfg->i(WAVETABLE_POLL_MS) != cfg->i(WAVETABLE_POLL_MS)) {
+            std::cerr << "Error: Instrument " << i << " of the ensemble must not set "
+                    << WAVETABLE_DIR << " or " << WAVETABLE_POLL_MS << "." << std::endl;
+            exit(1);
+        }
+
+        instrument->block.resize(blockSize);
+
+        // The mouse is reserved for the user interface
+        InputDevice* device = InputDevice::create(
+                instrument->cfg->str(INPUT_DEVICE), NULL);
+        device->setup(instrument->cfg);
+        instrument->inputIdx = inputThread->add_device(device);
+
+        instrument->synth.init(instrument->cfg);
+        instruments.push_back(instrument);
+    }
+
+    for (int i = 0; i < instruments.size(); i++) {
+
+        Instrument* instrument = instruments[i];
+        instrument->thread = std::thread(&Ensemble::work, this, instrument);
+
+        int core = instrument->cfg->i(RENDER_CORE);
+        if (core < 0 && numCores > 0) {
+            core = i % numCores;
+        }
+        Realtime::setup_thread(instrument->thread.native_handle(),
+                "rendering " + std::to_string(i),
+                realtime ? instrument->cfg->i(REALTIME_PRIORITY) : 0, core);
+    }
+
+    std::cout << "Set up an ensemble of " << instruments.size()
+            << " instruments." << std::endl;
+}
+
+/*
+ * Lets all instruments render their next block in parallel and
+ * writes the mix of these blocks, each one scaled by the gain of
+ * its instrument and clipped at full scale, into the given buffer
+ * (which must be able to hold get_block_size() samples).
+ * In-between two calls, all worker threads are idle, such that
+ * the instruments may be safely manipulated.
+ */
+void Ensemble::render_block(uint16_t* block) {
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        generation++;
+        numRendering = instruments.size();
+        blockRequested.notify_all();
+        blockDone.wait(lock, [&]{ return numRendering == 0; });
+    }
+
+    for (int i = 0; i < blockSize; i++) {
+        float sum = 0;
+        for (int j = 0; j < instruments.size(); j++) {
+            sum += instruments[j]->gain * instruments[j]->block[i];
+        }
+        block[i] = (uint16_t) std::min(sum, (float) UINT16_MAX);
+    }
+}
+
+/*
+ * Main routine of a worker thread: Renders a block
+ * whenever a new one is requested.
+ */
+void Ensemble::work(Instrument* instrument) {
+
+    int renderedGeneration = 0;
+    Timeline::register_thread("rendering " + std::to_string(instrument->index));
+    if (realtime) {
+        Realtime::prefault_stack();
+    }
+
+    while (true) {
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            blockRequested.wait(lock, [&]{
+                return exiting || generation != renderedGeneration;
+            });
+            if (exiting) {
+                return;
+            }
+            renderedGeneration = generation;
+        }
+
+        render(instrument);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            numRendering--;
+            if (numRendering == 0) {
+                blockDone.notify_one();
+            }
+        }
+    }
+}
+
+/*
+ * Synthesizes a single block of an instrument, applying
+ * the values of its input device as soon as they arrive.
+ */
+void Ensemble::render(Instrument* instrument) {
+
+    RtAudit::Scope audioPath;
+    Timeline::Scope phase("render");
+    WaveSynth& synth = instrument->synth;
+
+    for (int i = 0; i < blockSize; i++) {
+
+        int t = instrument->t;
+        InputValues values;
+        if (inputThread->read(instrument->inputIdx, &values,
+                              instrument->renderedSamples)) {
+            if (values.hasVolume) {
+                synth.update_volume(values.volume);
+            }
+            if (values.hasFrequency) {
+                synth.update_frequency(values.frequency);
+            }
+            if (values.hasMorph) {
+                synth.set_morph_position(values.morph);
+            }
+        }
+
+        instrument->block[i] = synth.wave(t);
+        synth.volume_tick();
+
+        instrument->t = (t == INT32_MAX ? 0 : t + 1);
+        instrument->renderedSamples++;
+    }
+}
+
+/*
+ * Stops the worker threads. The input devices are
+ * cleaned up by the input thread.
+ */
+void Ensemble::finish() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        exiting = true;
+        blockRequested.notify_all();
+    }
+
+    for (int i = 0; i < instruments.size(); i++) {
+        if (instruments[i]->thread.joinable()) {
+            instruments[i]->thread.join();
+        }
+        delete instruments[i]->cfg;
+        delete instruments[i];
+    }
+    instruments.clear();
+}
+
+int Ensemble::size() {
+    return instruments.size();
+}
+
+WaveSynth* Ensemble::get_synth(int idx) {
+    return &instruments[idx]->synth;
+}
+
+int Ensemble::get_block_size() {
+    return blockSize;
+}
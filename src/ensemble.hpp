@@ -0,0 +1,63 @@
+#ifndef THEREMIN_ENSEMBLE_H
+#define THEREMIN_ENSEMBLE_H
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "configuration.hpp"
+#include "wave_synth.hpp"
+#include "input_thread.hpp"
+
+/*
+ * Several instruments played at the same time, each one with its own
+ * input device and settings. Every instrument renders its blocks on a worker
+ * thread of its own (pinned to a core, and with real-time priority if
+ * configured); the calling thread mixes the
+ * rendered blocks into a single output.
+ */
+class Ensemble {
+
+public:
+    void setup(Configuration* cfg, InputThread* inputThread);
+    void render_block(uint16_t* block);
+    void finish();
+
+    int size();
+    WaveSynth* get_synth(int idx);
+    int get_block_size();
+
+private:
+    struct Instrument {
+        Configuration* cfg;
+        WaveSynth synth;
+        int index;
+        int inputIdx;
+        float gain;
+        std::thread thread;
+
+        std::vector<uint16_t> block;
+        int t = 1;
+        uint64_t renderedSamples = 0;
+    };
+
+    void work(Instrument* instrument);
+    void render(Instrument* instrument);
+
+    std::vector<Instrument*> instruments;
+    InputThread* inputThread;
+    int blockSize;
+    bool realtime;
+
+    // Synchronization of the workers: each generation is one block
+    std::mutex mutex;
+    std::condition_variable blockRequested;
+    std::condition_variable blockDone;
+    int generation = 0;
+    int numRendering = 0;
+    bool exiting = false;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <algorithm>
+
+#include "envelope.hpp"
+
+void Envelope::setup(double sampleRate, double attackMs, double decayMs,
+                     double sustainLevel, double releaseMs) {
+
+    attackLength = std::max(1, (int) (attackMs / 1000 * sampleRate));
+    decayLength = std::max(1, (int) (decayMs / 1000 * sampleRate));
+    this->sustainLevel = std::min(std::max(sustainLevel, 0.0), 1.0);
+    releaseLength = std::max(1, (int) (releaseMs / 1000 * sampleRate));
+}
+
+/*
+ * Starts the attack from silence.
+ */
+void Envelope::note_on() {
+
+    stage = ATTACK;
+    stagePosition = 0;
+    current = 0;
+    samplesUntilBlock = 0;
+}
+
+/*
+ * Starts the release from the current level.
+ */
+void Envelope::note_off() {
+
+    if (stage == IDLE) {
+        return;
+    }
+    stage = RELEASE;
+    stagePosition = 0;
+    releaseLevel = current;
+    samplesUntilBlock = 0;
+}
+
+/*
+ * Advances the envelope by a single sample.
+ */
+void Envelope::tick() {
+
+    if (samplesUntilBlock == 0) {
+        // Aim for the value at the end of the next control block
+        advance(CONTROL_BLOCK);
+        increment = (stage_value() - current) / CONTROL_BLOCK;
+        samplesUntilBlock = CONTROL_BLOCK;
+    }
+    current += increment;
+    samplesUntilBlock--;
+}
+
+float Envelope::value() {
+    return current;
+}
+
+/*
+ * True once the release has faded out completely.
+ */
+bool Envelope::is_idle() {
+    return stage == IDLE && samplesUntilBlock == 0;
+}
+
+bool Envelope::is_releasing() {
+    return stage == RELEASE || stage == IDLE;
+}
+
+/*
+ * Moves the position inside the stages by the given amount of samples.
+ */
+void Envelope::advance(int samples) {
+
+    stagePosition += samples;
+    if (stage == ATTACK && stagePosition >= attackLength) {
+        stage = DECAY;
+        stagePosition -= attackLength;
+    }
+    if (stage == DECAY && stagePosition >= decayLength) {
+        stage = SUSTAIN;
+    }
+    if (stage == RELEASE && stagePosition >= releaseLength) {
+        stage = IDLE;
+    }
+}
+
+/*
+ * The level of the envelope at the current position.
+ */
+float Envelope::stage_value() {
+
+    switch (stage) {
+    case ATTACK:
+        return std::sin(M_PI / 2 * stagePosition / attackLength);
+    case DECAY:
+        return 1 + (sustainLevel - 1) * stagePosition / decayLength;
+    case SUSTAIN:
+        return sustainLevel;
+    case RELEASE:
+        return releaseLevel * std::cos(M_PI / 2 * stagePosition / releaseLength);
+    default:
+        return 0;
+    }
+}
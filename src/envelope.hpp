@@ -0,0 +1,46 @@
+#ifndef THEREMIN_ENVELOPE_H
+#define THEREMIN_ENVELOPE_H
+
+/*
+ * An ADSR envelope of a single voice. The envelope is evaluated once per
+ * control block and interpolated linearly in-between, so tick() costs an
+ * addition per sample. Attack and release follow a quarter sine and
+ * cosine, such that a voice released while another one is attacked
+ * with the same length yields an equal-power crossfade.
+ */
+class Envelope {
+
+public:
+    void setup(double sampleRate, double attackMs, double decayMs,
+               double sustainLevel, double releaseMs);
+
+    void note_on();
+    void note_off();
+    void tick();
+
+    float value();
+    bool is_idle();
+    bool is_releasing();
+
+private:
+    enum Stage { IDLE, ATTACK, DECAY, SUSTAIN, RELEASE };
+    static const int CONTROL_BLOCK = 32;
+
+    void advance(int samples);
+    float stage_value();
+
+    int attackLength;
+    int decayLength;
+    float sustainLevel;
+    int releaseLength;
+
+    Stage stage = IDLE;
+    int stagePosition = 0;
+    float releaseLevel = 0;
+
+    float current = 0;
+    float increment = 0;
+    int samplesUntilBlock = 0;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include <iostream>
+
+#include "const.h"
+#include "input_device.hpp"
+#include "mouse_input.hpp"
+#include "sensor_input.hpp"
+#include "stdin_input.hpp"
+#include "osc_input.hpp"
+
+/*
+ * Creates the input device with the given name (one of the
+ * INPUT_DEVICE_* values). Exits if there is no such device.
+ * The mouse is only available if a user interface is given.
+ */
+InputDevice* InputDevice::create(std::string name, UserInterface* userInterface) {
+
+    if (name == INPUT_DEVICE_MOUSE && userInterface != NULL) {
+        return new MouseInput(userInterface);
+    } else if (name == INPUT_DEVICE_SENSOR || name == INPUT_DEVICE_TRACE) {
+        return new SensorInput();
+    } else if (name == INPUT_DEVICE_STDIN) {
+        return new StdinInput();
+    } else if (name == INPUT_DEVICE_OSC) {
+        return new OscInput();
+    }
+
+    std::cerr << "Error: Input device \"" << name
+            << "\" is not available." << std::endl;
+    exit(1);
+}
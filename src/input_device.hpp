@@ -0,0 +1,77 @@
+#ifndef THEREMIN_INPUT_DEVICE_H
+#define THEREMIN_INPUT_DEVICE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "configuration.hpp"
+
+class UserInterface;
+
+/*
+ * Values reported by an input device, each normalized to [0,1].
+ */
+struct InputValues {
+    double frequency = 0;
+    double volume = 0;
+    double morph = 0;
+    bool hasFrequency = false;
+    bool hasVolume = false;
+    bool hasMorph = false;
+    int64_t timestamp = 0; // microseconds, steady clock
+};
+
+/*
+ * A source of frequency and volume values (and possibly actions).
+ * Devices are driven by an InputThread: devices with a file descriptor
+ * are read whenever it becomes readable, all other devices are polled
+ * once per period. Devices with a period in samples are instead read
+ * by the synthesis path, once per that many played samples.
+ */
+class InputDevice {
+
+public:
+    virtual ~InputDevice() {}
+
+    virtual void setup(Configuration* cfg) = 0;
+    virtual void finish() {}
+
+    /*
+     * Reads the current values of the device.
+     * Returns false if there are none.
+     */
+    virtual bool read(InputValues* values) = 0;
+
+    /*
+     * The descriptor which becomes readable when new input arrives,
+     * or -1 if the device is to be polled periodically.
+     */
+    virtual int get_fd() { return -1; }
+    virtual double get_period_millis() { return 10; }
+
+    /*
+     * The period in played samples by which the device is to be read
+     * instead of by the wall clock (e.g. a trace replayed as fast as
+     * the audio is rendered), or 0.
+     */
+    virtual int get_period_samples() { return 0; }
+
+    /*
+     * True if the device will never report any values again.
+     */
+    virtual bool is_finished() { return false; }
+
+    /*
+     * Appends the triggered actions (at most MAX_POLLED_ACTIONS) in the
+     * same form as UserInterface::poll_events() to the given vector.
+     * Called from the main loop, concurrently to read().
+     */
+    static const int MAX_POLLED_ACTIONS = 64;
+    virtual bool has_actions() { return false; }
+    virtual void poll_actions(std::vector<std::string>& actions) {}
+
+    static InputDevice* create(std::string name, UserInterface* userInterface);
+};
+
+#endif
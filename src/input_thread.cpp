@@ -0,0 +1,222 @@
+#include <poll.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+
+#include "input_thread.hpp"
+#include "timeline.hpp"
+
+static int64_t now_micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Registers a device which has already been set up.
+ * Returns the index by which its values can be read.
+ */
+int InputThread::add_device(InputDevice* device) {
+
+    Slot* slot = new Slot();
+    slot->frequency = 0;
+    slot->volume = 0;
+    slot->morph = 0;
+    slot->timestamp = 0;
+    slot->frequencyChanged = false;
+    slot->volumeChanged = false;
+    slot->morphChanged = false;
+
+    devices.push_back(device);
+    slots.push_back(slot);
+    nextPollTimes.push_back(0);
+    samplePeriods.push_back(device->get_period_samples());
+    nextPollSamples.push_back(0);
+    return devices.size() - 1;
+}
+
+void InputThread::start() {
+
+    actions.reserve(devices.size() * InputDevice::MAX_POLLED_ACTIONS);
+    running = true;
+    finished = false;
+    thread = std::thread(&InputThread::run, this);
+}
+
+std::thread& InputThread::get_thread() {
+    return thread;
+}
+
+/*
+ * Stops the thread and cleans up all devices.
+ */
+void InputThread::stop() {
+
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    for (int i = 0; i < devices.size(); i++) {
+        devices[i]->finish();
+        delete devices[i];
+        delete slots[i];
+    }
+    devices.clear();
+    slots.clear();
+    nextPollTimes.clear();
+    samplePeriods.clear();
+    nextPollSamples.clear();
+}
+
+/*
+ * Writes the values of the given device which have changed since the
+ * last call into the given struct. Returns false if nothing changed.
+ * The given sample is the number of samples played so far.
+ */
+bool InputThread::read(int deviceIdx, InputValues* values, uint64_t sample) {
+
+    if (samplePeriods[deviceIdx] > 0) {
+        return read_paced(deviceIdx, values, sample);
+    }
+
+    Slot* slot = slots[deviceIdx];
+    values->hasFrequency = slot->frequencyChanged.load(std::memory_order_relaxed)
+            && slot->frequencyChanged.exchange(false, std::memory_order_acquire);
+    values->hasVolume = slot->volumeChanged.load(std::memory_order_relaxed)
+            && slot->volumeChanged.exchange(false, std::memory_order_acquire);
+    values->hasMorph = slot->morphChanged.load(std::memory_order_relaxed)
+            && slot->morphChanged.exchange(false, std::memory_order_acquire);
+    if (!values->hasFrequency && !values->hasVolume && !values->hasMorph) {
+        return false;
+    }
+
+    values->frequency = slot->frequency.load(std::memory_order_relaxed);
+    values->volume = slot->volume.load(std::memory_order_relaxed);
+    values->morph = slot->morph.load(std::memory_order_relaxed);
+    values->timestamp = slot->timestamp.load(std::memory_order_relaxed);
+    return true;
+}
+
+/*
+ * Reads a device paced by played samples on the calling thread,
+ * if its next period has begun with the given sample.
+ */
+bool InputThread::read_paced(int deviceIdx, InputValues* values, uint64_t sample) {
+
+    if (sample < nextPollSamples[deviceIdx]) {
+        return false;
+    }
+    nextPollSamples[deviceIdx] = sample + samplePeriods[deviceIdx];
+
+    InputDevice* device = devices[deviceIdx];
+    bool result = device->read(values);
+    values->timestamp = now_micros();
+    if (device->is_finished()) {
+        finished = true;
+    }
+    return result;
+}
+
+bool InputThread::has_actions() {
+
+    for (int i = 0; i < devices.size(); i++) {
+        if (devices[i]->has_actions()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * The actions triggered on all devices since the last call. The
+ * returned vector is reused by the next call, such that polling
+ * does not allocate on the audio path.
+ */
+const std::vector<std::string>& InputThread::poll_actions() {
+
+    actions.clear();
+    for (int i = 0; i < devices.size(); i++) {
+        devices[i]->poll_actions(actions);
+    }
+    return actions;
+}
+
+/*
+ * True as soon as one of the devices is finished for good
+ * (e.g. a replayed trace has ended).
+ */
+bool InputThread::is_finished() {
+    return finished;
+}
+
+/*
+ * Main routine of the thread: Waits for input on all devices with
+ * a descriptor and polls all other devices once per period.
+ */
+void InputThread::run() {
+
+    Timeline::register_thread("input");
+    std::vector<struct pollfd> pollFds(devices.size());
+
+    while (running) {
+
+        double now = now_micros() / 1000.0;
+        double timeout = 100;
+        for (int i = 0; i < devices.size(); i++) {
+            pollFds[i].fd = devices[i]->get_fd();
+            pollFds[i].events = POLLIN;
+            pollFds[i].revents = 0;
+            if (pollFds[i].fd < 0 && samplePeriods[i] == 0) {
+                timeout = std::min(timeout, nextPollTimes[i] - now);
+            }
+        }
+
+        poll(pollFds.data(), pollFds.size(), std::max(0, (int) std::ceil(timeout)));
+
+        now = now_micros() / 1000.0;
+        for (int i = 0; i < devices.size(); i++) {
+            if (samplePeriods[i] > 0) {
+                // Read by the synthesis path
+                continue;
+            }
+            if (pollFds[i].fd >= 0) {
+                if (pollFds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    read_device(i);
+                }
+            } else if (now >= nextPollTimes[i]) {
+                read_device(i);
+                double period = devices[i]->get_period_millis();
+                nextPollTimes[i] = std::max(nextPollTimes[i] + period, now);
+            }
+            if (devices[i]->is_finished()) {
+                finished = true;
+            }
+        }
+    }
+}
+
+/*
+ * Reads a device and publishes its values.
+ */
+void InputThread::read_device(int deviceIdx) {
+
+    Timeline::Scope phase("read device");
+    InputValues values;
+    if (!devices[deviceIdx]->read(&values)) {
+        return;
+    }
+
+    Slot* slot = slots[deviceIdx];
+    slot->timestamp.store(now_micros(), std::memory_order_relaxed);
+    if (values.hasFrequency) {
+        slot->frequency.store(values.frequency, std::memory_order_relaxed);
+        slot->frequencyChanged.store(true, std::memory_order_release);
+    }
+    if (values.hasVolume) {
+        slot->volume.store(values.volume, std::memory_order_relaxed);
+        slot->volumeChanged.store(true, std::memory_order_release);
+    }
+    if (values.hasMorph) {
+        slot->morph.store(values.morph, std::memory_order_relaxed);
+        slot->morphChanged.store(true, std::memory_order_release);
+    }
+}
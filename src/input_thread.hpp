@@ -0,0 +1,65 @@
+#ifndef THEREMIN_INPUT_THREAD_H
+#define THEREMIN_INPUT_THREAD_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "input_device.hpp"
+
+/*
+ * Runs the I/O of any number of input devices on a single thread
+ * of its own. The latest values of each device are published into
+ * a lock-free slot, from which the synthesis path can read them at
+ * the cost of an atomic load. Devices paced by played samples are
+ * read directly by the synthesis path instead, which keeps them
+ * independent of the wall clock.
+ */
+class InputThread {
+
+public:
+    int add_device(InputDevice* device);
+    void start();
+    void stop();
+
+    bool read(int deviceIdx, InputValues* values, uint64_t sample);
+    bool has_actions();
+    const std::vector<std::string>& poll_actions();
+    bool is_finished();
+    std::thread& get_thread();
+
+private:
+    struct Slot {
+        std::atomic<double> frequency;
+        std::atomic<double> volume;
+        std::atomic<double> morph;
+        std::atomic<int64_t> timestamp;
+        std::atomic<bool> frequencyChanged;
+        std::atomic<bool> volumeChanged;
+        std::atomic<bool> morphChanged;
+    };
+
+    void run();
+    void read_device(int deviceIdx);
+    bool read_paced(int deviceIdx, InputValues* values, uint64_t sample);
+
+    std::vector<InputDevice*> devices;
+    std::vector<Slot*> slots;
+    std::vector<double> nextPollTimes;
+
+    // Devices paced by played samples: the period
+    // (0 for all other devices) and the next sample to read at
+    std::vector<int> samplePeriods;
+    std::vector<uint64_t> nextPollSamples;
+
+    // Actions of the last poll, reserved for all devices at start
+    std::vector<std::string> actions;
+
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<bool> finished;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <cmath>
+
+#include "const.h"
+#include "lfo.hpp"
+
+void Lfo::setup(double sampleRate, std::string shape, double frequency) {
+
+    this->sampleRate = sampleRate;
+    if (shape == LFO_SINE) {
+        this->shape = SINE;
+    } else if (shape == LFO_TRIANGLE) {
+        this->shape = TRIANGLE;
+    } else if (shape == LFO_RANDOM) {
+        this->shape = RANDOM;
+    } else {
+        std::cerr << "Error: Unknown LFO shape \"" << shape << "\"." << std::endl;
+        exit(1);
+    }
+    set_frequency(frequency);
+}
+
+void Lfo::set_frequency(double frequency) {
+    phaseIncrement = frequency * CONTROL_BLOCK / sampleRate;
+}
+
+/*
+ * The frequency configured by the given keys: if the sync key is positive,
+ * one cycle lasts that many beats of the configured tempo, otherwise
+ * the frequency key holds the oscillations per second.
+ */
+double Lfo::frequency(Configuration* cfg, const char* frequencyKey,
+                      const char* syncKey) {
+
+    double beats = cfg->d(syncKey);
+    if (beats > 0) {
+        return cfg->d(LFO_TEMPO) / 60 / beats;
+    }
+    return cfg->d(frequencyKey);
+}
+
+/*
+ * (Re)starts the oscillation at phase zero. An oscillation
+ * which is being stopped just continues instead.
+ */
+void Lfo::start() {
+
+    if (running && stopping) {
+        stopping = false;
+        return;
+    }
+    running = true;
+    stopping = false;
+    phase = 0;
+    randomFrom = 0;
+    randomTo = next_random();
+}
+
+/*
+ * Stops the oscillation at its next zero crossing.
+ */
+void Lfo::stop() {
+    if (running) {
+        stopping = true;
+    }
+}
+
+/*
+ * Advances the oscillator by a single sample. Returns true
+ * if a new control block has begun with this sample.
+ */
+bool Lfo::tick() {
+
+    bool newBlock = (samplesUntilBlock == 0);
+    if (newBlock) {
+        // Aim for the value at the end of the next control block
+        current = target;
+        if (running) {
+            phase += phaseIncrement;
+            if (phase >= 1) {
+                phase -= std::floor(phase);
+                randomFrom = randomTo;
+                randomTo = (stopping ? 0 : next_random());
+            }
+            float next = shape_value();
+            if (stopping && (next == 0 || (next < 0) != (target < 0))) {
+                running = false;
+                stopping = false;
+                next = 0;
+            }
+            target = next;
+        }
+        increment = (target - current) / CONTROL_BLOCK;
+        samplesUntilBlock = CONTROL_BLOCK;
+    }
+    current += increment;
+    samplesUntilBlock--;
+    return newBlock;
+}
+
+float Lfo::value() {
+    return current;
+}
+
+/*
+ * True as long as the output differs from zero
+ * (including the way back to zero after stopping).
+ */
+bool Lfo::is_active() {
+    return running || current != 0 || target != 0;
+}
+
+/*
+ * True if the oscillation is started and not being stopped.
+ */
+bool Lfo::is_running() {
+    return running && !stopping;
+}
+
+/*
+ * The value of the waveform at the current phase.
+ */
+float Lfo::shape_value() {
+
+    switch (shape) {
+    case SINE:
+        return std::sin(2 * M_PI * phase);
+    case TRIANGLE:
+        if (phase < 0.25) {
+            return 4 * phase;
+        } else if (phase < 0.75) {
+            return 2 - 4 * phase;
+        }
+        return 4 * phase - 4;
+    default:
+        // Cosine interpolation between two random values per cycle
+        return randomFrom + (randomTo - randomFrom) * (1 - std::cos(M_PI * phase)) / 2;
+    }
+}
+
+/*
+ * A pseudo-random value in [-1,1] (xorshift).
+ */
+float Lfo::next_random() {
+
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState / 2147483648.0f - 1;
+}
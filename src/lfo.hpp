@@ -0,0 +1,61 @@
+#ifndef THEREMIN_LFO_H
+#define THEREMIN_LFO_H
+
+#include <stdint.h>
+#include <string>
+
+#include "configuration.hpp"
+
+/*
+ * A low frequency oscillator in [-1,1] (sine, triangle or a smoothly
+ * interpolated random walk). Like the Envelope, it is evaluated once per
+ * control block and interpolated linearly in-between, so tick() costs
+ * an addition per sample. The oscillation always starts at phase zero
+ * and, when stopped, runs on until its next zero crossing, such that
+ * whatever it modulates returns to its original value without a jump.
+ */
+class Lfo {
+
+public:
+    static const int CONTROL_BLOCK = 32;
+
+    void setup(double sampleRate, std::string shape, double frequency);
+    void set_frequency(double frequency);
+
+    void start();
+    void stop();
+    bool tick();
+
+    float value();
+    bool is_active();
+    bool is_running();
+
+    static double frequency(Configuration* cfg, const char* frequencyKey,
+                            const char* syncKey);
+
+private:
+    enum Shape { SINE, TRIANGLE, RANDOM };
+
+    float shape_value();
+    float next_random();
+
+    Shape shape;
+    double sampleRate;
+    double phaseIncrement; // per control block, in cycles
+
+    bool running = false;
+    bool stopping = false;
+    double phase = 0;
+
+    // Random walk: values at the start and end of the current cycle
+    uint32_t randomState = 0x12345678;
+    float randomFrom = 0;
+    float randomTo = 0;
+
+    float target = 0;
+    float current = 0;
+    float increment = 0;
+    int samplesUntilBlock = 0;
+};
+
+#endif
@@ -7,17 +7,37 @@
 #include "wave_synth.hpp"
 #include "user_interface.hpp"
 #include "audio.hpp"
-#include "sensor_input.hpp"
+#include "input_device.hpp"
+#include "input_thread.hpp"
+#include "osc_input.hpp"
+#include "ensemble.hpp"
+#include "performance_capture.hpp"
+#include "metrics.hpp"
+#include "timeline.hpp"
+#include "rt_audit.hpp"
+#include "realtime.hpp"
 
 WaveSynth synth;
 UserInterface userInterface;
 Audio audio;
-SensorInput sensorInput;
+Ensemble ensemble;
+
+// Input devices, the index of the device playing the single instrument
+// and of the network input if it only controls the instruments
+InputThread inputThread;
+int inputIdx = -1;
+int oscIdx = -1;
+
+// The synthesizers which are affected by key actions
+std::vector<WaveSynth*> synths;
+
+// Control events of the single instrument, timed by the samples
+// played so far
+PerformanceCapture capture;
+uint64_t playedSamples = 0;
 
 Configuration* cfg;
 
-int periodInputMouse;
-int periodInputSensor;
 int periodInputGeneral;
 int periodDisplayRefresh;
 
@@ -26,57 +46,48 @@ int periodDisplayRefresh;
  */
 void finish() {
     
+    capture.stop_recording(playedSamples);
+    Metrics::stop();
+    Timeline::finish();
+    RtAudit::report();
     audio.set_exiting(true);
     
-    if (cfg->str(INPUT_DEVICE) == INPUT_DEVICE_SENSOR) {
-        sensorInput.finish();
-        std::cout << "Finished sensor connection." << std::endl;
+    if (ensemble.size() > 0) {
+        ensemble.finish();
+        std::cout << "Finished ensemble." << std::endl;
     }
     
+    inputThread.stop();
+    std::cout << "Finished input devices." << std::endl;
+    
     userInterface.clean_up();
     
     delete cfg;
 }
 
+/*
+ * Records the action bound to the given key into the performance capture.
+ */
+void capture_action(std::string action) {
+    
+    for (int i = 0; i < sizeof(ACTION_NAMES)/sizeof(*ACTION_NAMES); i++) {
+        if (action == cfg->str(ACTION_NAMES[i])) {
+            capture.record_action(i, playedSamples);
+            return;
+        }
+    }
+}
+
 /*
  * Help function called at each n-th iteration processing the secondary
  * (i.e. keyboard press) input events.
  */
-void process_input(std::vector<std::string> actions) {
+void process_input(const std::vector<std::string>& actions) {
     
     for (int actionIdx = 0; actionIdx < actions.size(); actionIdx++) {
-        std::string action = actions[actionIdx];
-        
-        if (action == cfg->str(ACTION_SUSTAIN_NOTE)) {
-            if (!synth.is_secondary_frequency_active()) {
-                synth.set_secondary_frequency(synth.frequency);
-            } else {
-                synth.set_secondary_frequency(0.0);
-            }
-            
-        } else if (action == cfg->str(ACTION_OCTAVE_UP)) {
-            if (!synth.is_octave_offset()) {
-                synth.set_octave_offset(true);
-            } else {
-                synth.set_octave_offset(false);
-            }
-            
-        } else if (action == cfg->str(ACTION_CHANGE_WAVEFORM)) {
-            synth.switch_waveform();
-            
-        } else if (action == cfg->str(ACTION_AUTOTUNE_NONE)) {
-            synth.set_autotune_mode(AUTOTUNE_NONE);
-            
-        } else if (action == cfg->str(ACTION_AUTOTUNE_SMOOTH)) {
-            synth.set_autotune_mode(AUTOTUNE_SMOOTH);
-            
-        } else if (action == cfg->str(ACTION_AUTOTUNE_FULL)) {
-            synth.set_autotune_mode(AUTOTUNE_FULL);
-            
-        } else if (action == cfg->str(ACTION_TREMOLO)) {
-            synth.set_tremolo(!synth.is_tremolo_enabled());
+        const std::string& action = actions[actionIdx];
         
-        } else if (action == cfg->str(ACTION_RECORDING_REPLAYING)) {
+        if (action == cfg->str(ACTION_RECORDING_REPLAYING)) {
             if (!audio.is_recording() && !audio.is_replaying()) {
                 audio.start_recording();
             } else if (audio.is_recording() && !audio.is_replaying()) {
@@ -90,21 +101,36 @@ void process_input(std::vector<std::string> actions) {
                 exit(1);
             }
             
-        } else if (action == cfg->str(ACTION_CHORD_MAJOR_1)) {
-            synth.set_chord_notes(CHORD_MODE_1, CHORD_KEY_MAJOR);
-        } else if (action == cfg->str(ACTION_CHORD_MAJOR_3)) {
-            synth.set_chord_notes(CHORD_MODE_3, CHORD_KEY_MAJOR);
-        } else if (action == cfg->str(ACTION_CHORD_MAJOR_5)) {
-            synth.set_chord_notes(CHORD_MODE_5, CHORD_KEY_MAJOR);
-        } else if (action == cfg->str(ACTION_CHORD_MINOR_1)) {
-            synth.set_chord_notes(CHORD_MODE_1, CHORD_KEY_MINOR);
-        } else if (action == cfg->str(ACTION_CHORD_MINOR_3)) {
-            synth.set_chord_notes(CHORD_MODE_3, CHORD_KEY_MINOR);
-        } else if (action == cfg->str(ACTION_CHORD_MINOR_5)) {
-            synth.set_chord_notes(CHORD_MODE_5, CHORD_KEY_MINOR);
-        } else if (action == cfg->str(ACTION_CHORD_CLEAR)) {
-            synth.clear_child_notes();
+        } else if (action == cfg->str(ACTION_DUMP_TIMELINE)) {
+            Timeline::request_dump();
+            
+        } else if (action == cfg->str(ACTION_TREMOLO)) {
+            // The tremolo is part of the effects applied to the output
+            EffectsChain* effects = audio.get_effects();
+            effects->set_enabled(EFFECT_TREMOLO, !effects->is_enabled(EFFECT_TREMOLO));
+            capture_action(action);
+            
+        } else {
+            for (int i = 0; i < synths.size(); i++) {
+                synths[i]->apply_action(action);
+            }
+            capture_action(action);
+        }
+    }
+}
+
+/*
+ * Applies the morph position received by the network input
+ * (unless it plays the instrument) to all synthesizers.
+ */
+void process_network_input() {
+    
+    InputValues values;
+    if (oscIdx >= 0 && inputThread.read(oscIdx, &values, playedSamples) && values.hasMorph) {
+        for (int i = 0; i < synths.size(); i++) {
+            synths[i]->set_morph_position(values.morph);
         }
+        capture.record(PERFORMANCE_MORPH, values.morph, playedSamples);
     }
 }
 
@@ -115,44 +141,41 @@ void process_input(std::vector<std::string> actions) {
 void main_loop(int *t) {
         
     /*
-     * Process primary input to adjust volume and frequency
+     * Process primary input to adjust volume and frequency,
+     * as soon as the input thread has published new values
      */
-    if (cfg->str(INPUT_DEVICE) == INPUT_DEVICE_MOUSE) {
-        
-        // Grab input by mouse cursor
-        if (*t % periodInputMouse == 0) {
-            float x_value = 0, y_value = 0;
-            userInterface.last_cursor_position(&x_value, &y_value);
-            synth.update_frequency(y_value);
-            synth.update_volume(x_value);
+    InputValues values;
+    if (inputThread.read(inputIdx, &values, playedSamples)) {
+        if (values.hasVolume) {
+            synth.update_volume(values.volume);
+            capture.record(PERFORMANCE_VOLUME, values.volume, playedSamples);
         }
-        
-    } else if (cfg->str(INPUT_DEVICE) == INPUT_DEVICE_SENSOR) {
-        
-        // Grab input by Tinkerforge sensors
-        if (*t % periodInputSensor == 0) {
-            double value = 0.0;
-            bool valueOk;
-            valueOk = sensorInput.volume_value(&value);
-            if (valueOk) {
-                synth.update_volume(value);
-            }
-            valueOk = sensorInput.frequency_value(&value);
-            if (valueOk) {
-                synth.update_frequency(value);
-            }
+        if (values.hasFrequency) {
+            synth.update_frequency(values.frequency);
+            capture.record(PERFORMANCE_FREQUENCY, values.frequency, playedSamples);
         }
-        
-    } else {
-        std::cerr << "No input device specified." << std::endl;
-        exit(1);
-    }    
+        if (values.hasMorph) {
+            synth.set_morph_position(values.morph);
+            capture.record(PERFORMANCE_MORPH, values.morph, playedSamples);
+        }
+    }
+    process_network_input();
     
     /*
     * Process secondary input (by keyboard or foot switch)
     */
     if (*t % periodInputGeneral == 0) {
+        Timeline::Scope phase("key poll");
         process_input(userInterface.poll_events());
+        
+        if (inputThread.is_finished()) {
+            std::cout << "Input device finished." << std::endl;
+            exit(0);
+        }
+    }
+    if (inputThread.has_actions()) {
+        Timeline::Scope phase("actions");
+        process_input(inputThread.poll_actions());
     }
     
     /*
@@ -160,12 +183,16 @@ void main_loop(int *t) {
      * If it is being declined, move one step backwards
      * to keep the waveform continuous.
      */
-    if (audio.new_sample(synth.wave(*t))) {
-        // Update the current volume 
-        // in direction of the current volume target
-        synth.volume_tick();
-    } else {
-        (*t)--;
+    {
+        RtAudit::Scope audioPath;
+        if (audio.new_sample(synth.wave(*t))) {
+            // Update the current volume 
+            // in direction of the current volume target
+            synth.volume_tick();
+            playedSamples++;
+        } else {
+            (*t)--;
+        }
     }
 
     /*
@@ -181,6 +208,7 @@ void main_loop(int *t) {
      * Refresh the drawn surface at some times, if enabled
      */
     if (cfg->b(REALTIME_DISPLAY) && (*t % periodDisplayRefresh == 0)) {
+        Timeline::Scope phase("display refresh");
         userInterface.refresh_surface();
     }
 #else
@@ -188,6 +216,7 @@ void main_loop(int *t) {
      * Refresh terminal output
      */
     if (*t % periodDisplayRefresh == 0) {
+        Timeline::Scope phase("display refresh");
         userInterface.refresh_surface();
     }
 #endif
@@ -201,6 +230,68 @@ void main_loop(int *t) {
     }
 }
 
+/*
+ * Called every iteration in ensemble mode. Lets all instruments render 
+ * a block in parallel and feeds the mixed block to the audio buffer.
+ * Key actions and display refreshes are processed while the instruments
+ * are idle.
+ */
+void main_loop_ensemble(int *t, uint16_t* block) {
+    
+    // The instruments are idle in-between two blocks
+    process_network_input();
+    {
+        Timeline::Scope phase("ensemble block");
+        ensemble.render_block(block);
+    }
+    
+    for (int i = 0; i < ensemble.get_block_size(); ) {
+        
+        // Start playing if the audio buffer is full for the first time
+        if (audio.is_buffer_full() && !audio.is_playing()) {
+            audio.start_playing();
+        }
+        {
+            RtAudit::Scope audioPath;
+            if (!audio.new_sample(block[i])) {
+                continue;
+            }
+        }
+        i++;
+        (*t)++;
+        
+        if (*t % periodInputGeneral == 0) {
+            Timeline::Scope phase("key poll");
+            process_input(userInterface.poll_events());
+            
+            if (inputThread.is_finished()) {
+                std::cout << "Input device finished." << std::endl;
+                exit(0);
+            }
+        }
+        if (inputThread.has_actions()) {
+            Timeline::Scope phase("actions");
+            process_input(inputThread.poll_actions());
+        }
+        
+#ifdef THEREMIN_GUI
+        if (cfg->b(REALTIME_DISPLAY) && (*t % periodDisplayRefresh == 0)) {
+            Timeline::Scope phase("display refresh");
+            userInterface.refresh_surface();
+        }
+#else
+        if (*t % periodDisplayRefresh == 0) {
+            Timeline::Scope phase("display refresh");
+            userInterface.refresh_surface();
+        }
+#endif
+        
+        if (*t == INT32_MAX) {
+            *t = 0;
+        }
+    }
+}
+
 int main(int argc, const char* argv[]) 
 {
     
@@ -208,6 +299,11 @@ int main(int argc, const char* argv[])
     cfg = new Configuration();
     cfg->load();
     
+    // Timeline of the phases of all threads, the main thread
+    // running the audio path
+    Timeline::setup(cfg);
+    Timeline::register_thread("audio");
+    
     // Disallow launching Theresa with CLI and mouse as input method
 #ifndef THEREMIN_GUI
     if (cfg->str(INPUT_DEVICE) == INPUT_DEVICE_MOUSE) {
@@ -222,33 +318,93 @@ Tinkerforge distance sensors." << std::endl;
         
     // Calculate periods for various tasks
     int sampleRate = cfg->i(SAMPLE_RATE);
-    periodInputMouse = sampleRate / cfg->i(TASK_FREQUENCY_INPUT_MOUSE);
-    periodInputSensor = sampleRate / cfg->i(TASK_FREQUENCY_INPUT_SENSOR);
     periodInputGeneral = sampleRate / cfg->i(TASK_FREQUENCY_INPUT_GENERAL);
     periodDisplayRefresh = sampleRate / cfg->i(TASK_FREQUENCY_DISPLAY_REFRESH);
     
+    // Ensemble of several instruments, each with its own input device
+    if (cfg->num_entries(ENSEMBLE) > 0) {
+        ensemble.setup(cfg, &inputThread);
+        for (int i = 0; i < ensemble.size(); i++) {
+            synths.push_back(ensemble.get_synth(i));
+        }
+    } else {
+        synths.push_back(&synth);
+    }
+    
     // Basic input (i.e. mouse and keys / footswitch)
     // and graphical output
-    userInterface.setup(cfg, &synth, &audio);
+    userInterface.setup(cfg, synths[0], &audio);
     
-    // Sensor input
-    if (cfg->str(INPUT_DEVICE) == INPUT_DEVICE_SENSOR) {
-        sensorInput.setup_sensors(cfg);
+    // Primary input device of the single instrument
+    if (ensemble.size() == 0) {
+        InputDevice* device = InputDevice::create(cfg->str(INPUT_DEVICE),
+                                                  &userInterface);
+        device->setup(cfg);
+        inputIdx = inputThread.add_device(device);
     }
     
+    // Network input of actions only, if it does not play the instrument
+    if (cfg->b(OSC_ENABLED) && (ensemble.size() > 0 
+            || cfg->str(INPUT_DEVICE) != INPUT_DEVICE_OSC)) {
+        OscInput* oscInput = new OscInput();
+        oscInput->setup(cfg);
+        oscIdx = inputThread.add_device(oscInput);
+    }
+    inputThread.start();
+    
     // Audio output stuff
     audio.setup_audio(cfg);
     
+    // Telemetry for monitoring
+    Metrics::start(cfg);
+    
     // Wave synthesizer
-    synth.init(cfg);
+    if (ensemble.size() == 0) {
+        synth.init(cfg);
+    }
+    
+    // Capture of the control events, to be rendered again offline
+    std::string capturePath = cfg->str(PERFORMANCE_CAPTURE);
+    if (!capturePath.empty() && ensemble.size() > 0) {
+        std::cerr << "Warning: Performances of an ensemble cannot be "
+                "captured." << std::endl;
+    } else if (!capturePath.empty()) {
+        capture.start_recording(capturePath, sampleRate);
+    }
     
     // Program exit callback
     atexit(finish);
     
+    // Real-time scheduling and memory locking, as far as permitted.
+    // The main thread runs the audio path.
+    if (cfg->b(REALTIME_ENABLED)) {
+        if (cfg->b(REALTIME_LOCK_MEMORY)) {
+            Realtime::lock_memory();
+        }
+        Realtime::setup_thread(pthread_self(), "audio",
+                               cfg->i(REALTIME_PRIORITY), cfg->i(AUDIO_CORE));
+    } else if (cfg->i(AUDIO_CORE) >= 0) {
+        Realtime::setup_thread(pthread_self(), "audio", 0, cfg->i(AUDIO_CORE));
+    }
+    if (cfg->i(CONTROL_CORE) >= 0) {
+        Realtime::setup_thread(inputThread.get_thread().native_handle(),
+                               "control", 0, cfg->i(CONTROL_CORE));
+    }
+    
+    // Watch the audio path from now on (debug builds only)
+    RtAudit::enable();
+    
     std::cout << "Setup completed, beginning main loop." << std::endl;
     
     // Run main loop until closed
-    for (int t = 1; ; t++) {
-        main_loop(&t);
+    if (ensemble.size() > 0) {
+        std::vector<uint16_t> block(ensemble.get_block_size());
+        for (int t = 1; ; ) {
+            main_loop_ensemble(&t, &block[0]);
+        }
+    } else {
+        for (int t = 1; ; t++) {
+            main_loop(&t);
+        }
     }
 }
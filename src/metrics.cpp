@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sstream>
+
+#include "const.h"
+#include "metrics.hpp"
+
+// Upper bounds of the buckets of the durations, in seconds
+#define DURATION_BUCKETS {0.0001, 0.0002, 0.0005, 0.001, 0.002, 0.005, \
+                          0.01, 0.02, 0.05, 0.1, 0.2, 0.5}
+
+// How often the serving thread checks whether it should stop,
+// and how long it waits for the request of a client
+#define METRICS_POLL_MS 200
+#define METRICS_REQUEST_TIMEOUT_MS 1000
+
+Metrics::Counter Metrics::blocksRendered;
+Metrics::Histogram Metrics::blockRenderSeconds(DURATION_BUCKETS);
+Metrics::Gauge Metrics::renderLoad;
+Metrics::Counter Metrics::underruns;
+Metrics::Gauge Metrics::queuedSamples;
+Metrics::Gauge Metrics::targetBlocks;
+Metrics::Histogram Metrics::sensorReadSeconds(DURATION_BUCKETS);
+Metrics::Counter Metrics::frequencyValuesDropped;
+Metrics::Counter Metrics::frequencyValuesOutOfRange;
+Metrics::Counter Metrics::displayRefreshes;
+
+int Metrics::socketFd = -1;
+std::string Metrics::socketPath;
+std::thread Metrics::thread;
+std::atomic<bool> Metrics::running{false};
+
+void Metrics::Counter::add(uint64_t amount) {
+    value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::Counter::get() {
+    return value.load(std::memory_order_relaxed);
+}
+
+void Metrics::Gauge::set(double value) {
+    this->value.store(value, std::memory_order_relaxed);
+}
+
+double Metrics::Gauge::get() {
+    return value.load(std::memory_order_relaxed);
+}
+
+Metrics::Histogram::Histogram(std::initializer_list<double> bounds) {
+
+    for (double bound : bounds) {
+        if (numBounds < MAX_BUCKETS) {
+            this->bounds[numBounds++] = bound;
+        }
+    }
+    for (int i = 0; i <= MAX_BUCKETS; i++) {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::Histogram::observe(double seconds) {
+
+    int bucket = 0;
+    while (bucket < numBounds && seconds > bounds[bucket]) {
+        bucket++;
+    }
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sumNanos.fetch_add((uint64_t) (seconds * 1e9), std::memory_order_relaxed);
+}
+
+/*
+ * The samples of the histogram in the text format, with
+ * cumulative buckets as Prometheus expects them.
+ */
+std::string Metrics::Histogram::format(std::string name) {
+
+    std::ostringstream out;
+    out.precision(12);
+    uint64_t count = 0;
+    for (int i = 0; i < numBounds; i++) {
+        count += counts[i].load(std::memory_order_relaxed);
+        out << name << "_bucket{le=\"" << bounds[i] << "\"} " << count << "\n";
+    }
+    count += counts[numBounds].load(std::memory_order_relaxed);
+    out << name << "_bucket{le=\"+Inf\"} " << count << "\n";
+    out << name << "_sum " << sumNanos.load(std::memory_order_relaxed) / 1e9 << "\n";
+    out << name << "_count " << count << "\n";
+    return out.str();
+}
+
+/*
+ * Starts serving the metrics, if enabled: on the configured Unix
+ * socket, or on the configured port of the loopback interface.
+ */
+void Metrics::start(Configuration* cfg) {
+
+    if (!cfg->b(METRICS_ENABLED)) {
+        return;
+    }
+
+    socketPath = cfg->str(METRICS_SOCKET);
+    if (!socketPath.empty()) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            fprintf(stderr, "The metrics socket path \"%s\" is too long.\n",
+                    socketPath.c_str());
+            exit(1);
+        }
+        strcpy(address.sun_path, socketPath.c_str());
+        // A socket left behind by a previous run would block the path
+        unlink(socketPath.c_str());
+        socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socketFd < 0 || bind(socketFd, (struct sockaddr*) &address, sizeof(address)) < 0
+                || listen(socketFd, 4) < 0) {
+            fprintf(stderr, "Could not serve metrics on \"%s\".\n", socketPath.c_str());
+            exit(1);
+        }
+    } else {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(cfg->i(METRICS_PORT));
+        int reuse = 1;
+        socketFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (socketFd >= 0) {
+            setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (socketFd < 0 || bind(socketFd, (struct sockaddr*) &address, sizeof(address)) < 0
+                || listen(socketFd, 4) < 0) {
+            fprintf(stderr, "Could not serve metrics on port %d.\n", cfg->i(METRICS_PORT));
+            exit(1);
+        }
+    }
+
+    running = true;
+    thread = std::thread(&Metrics::serve);
+}
+
+void Metrics::stop() {
+
+    if (!running) {
+        return;
+    }
+    running = false;
+    thread.join();
+    close(socketFd);
+    if (!socketPath.empty()) {
+        unlink(socketPath.c_str());
+    }
+}
+
+/*
+ * Main routine of the serving thread: answers each connection
+ * with the current metrics, as an HTTP response.
+ */
+void Metrics::serve() {
+
+    while (running) {
+        struct pollfd pollFd = {socketFd, POLLIN, 0};
+        if (poll(&pollFd, 1, METRICS_POLL_MS) <= 0) {
+            continue;
+        }
+        int client = accept(socketFd, NULL, NULL);
+        if (client < 0) {
+            continue;
+        }
+
+        // The request itself does not matter, but the client expects
+        // it to be read before the response
+        struct timeval timeout = {METRICS_REQUEST_TIMEOUT_MS / 1000,
+                                  (METRICS_REQUEST_TIMEOUT_MS % 1000) * 1000};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string request;
+        char buffer[1024];
+        int size;
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192
+                && (size = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+            request.append(buffer, size);
+        }
+
+        std::string body = format();
+        std::string response = "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t result = send(client, response.data() + sent,
+                                  response.size() - sent, MSG_NOSIGNAL);
+            if (result <= 0) {
+                break;
+            }
+            sent += result;
+        }
+        close(client);
+    }
+}
+
+/*
+ * All metrics in the Prometheus text format.
+ */
+std::string Metrics::format() {
+
+    std::ostringstream out;
+    out.precision(12);
+    auto header = [&](const char* name, const char* type, const char* help) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+    };
+
+    header("theresa_blocks_rendered_total", "counter", "Audio blocks rendered.");
+    out << "theresa_blocks_rendered_total " << blocksRendered.get() << "\n";
+    header("theresa_block_render_seconds", "histogram", "Time to render an audio block.");
+    out << blockRenderSeconds.format("theresa_block_render_seconds");
+    header("theresa_render_load", "gauge",
+           "Time to render the last block relative to the time it plays.");
+    out << "theresa_render_load " << renderLoad.get() << "\n";
+    header("theresa_underruns_total", "counter", "Times the audio queue ran empty.");
+    out << "theresa_underruns_total " << underruns.get() << "\n";
+    header("theresa_queued_samples", "gauge",
+           "Samples queued at the audio device before the last block was written.");
+    out << "theresa_queued_samples " << queuedSamples.get() << "\n";
+    header("theresa_target_blocks", "gauge", "Blocks the audio queue is kept at.");
+    out << "theresa_target_blocks " << targetBlocks.get() << "\n";
+
+    header("theresa_sensor_read_seconds", "histogram", "Time to read a distance sensor.");
+    out << sensorReadSeconds.format("theresa_sensor_read_seconds");
+    header("theresa_frequency_values_dropped_total", "counter",
+           "Frequency sensor readings which failed.");
+    out << "theresa_frequency_values_dropped_total " << frequencyValuesDropped.get() << "\n";
+    header("theresa_frequency_values_out_of_range_total", "counter",
+           "Frequency sensor readings above sensor_freq_max_value.");
+    out << "theresa_frequency_values_out_of_range_total "
+            << frequencyValuesOutOfRange.get() << "\n";
+
+    header("theresa_display_refreshes_total", "counter", "Refreshes of the display.");
+    out << "theresa_display_refreshes_total " << displayRefreshes.get() << "\n";
+
+    // CPU time of the whole process, as counted by the kernel
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpuSeconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    header("process_cpu_seconds_total", "counter", "User and system CPU time spent.");
+    out << "process_cpu_seconds_total " << cpuSeconds << "\n";
+    return out.str();
+}
@@ -0,0 +1,86 @@
+#ifndef THEREMIN_METRICS_H
+#define THEREMIN_METRICS_H
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <initializer_list>
+
+#include "configuration.hpp"
+
+/*
+ * Counters, gauges and histograms of the running program, served in
+ * the Prometheus text format to whoever connects to a local port or
+ * Unix socket (e.g. a Prometheus server or "curl --unix-socket").
+ * Each update is a relaxed atomic operation on memory allocated at
+ * startup, such that the audio, input and UI threads can update them
+ * at any time; only the serving thread formats the values, whenever
+ * a scrape arrives.
+ */
+class Metrics {
+
+public:
+    class Counter {
+    public:
+        void add(uint64_t amount = 1);
+        uint64_t get();
+    private:
+        std::atomic<uint64_t> value{0};
+    };
+
+    class Gauge {
+    public:
+        void set(double value);
+        double get();
+    private:
+        std::atomic<double> value{0};
+    };
+
+    // Distribution of durations in seconds, by the given upper
+    // bounds of its buckets (ascending)
+    class Histogram {
+    public:
+        static const int MAX_BUCKETS = 16;
+        Histogram(std::initializer_list<double> bounds);
+        void observe(double seconds);
+        std::string format(std::string name);
+    private:
+        double bounds[MAX_BUCKETS];
+        int numBounds = 0;
+        // Observations per bucket (not cumulative), the last
+        // one being above all bounds
+        std::atomic<uint64_t> counts[MAX_BUCKETS + 1];
+        std::atomic<uint64_t> sumNanos{0};
+    };
+
+    // Audio output (audio path)
+    static Counter blocksRendered;
+    static Histogram blockRenderSeconds;
+    static Gauge renderLoad;
+    static Counter underruns;
+    static Gauge queuedSamples;
+    static Gauge targetBlocks;
+
+    // Sensors (input thread)
+    static Histogram sensorReadSeconds;
+    static Counter frequencyValuesDropped;
+    static Counter frequencyValuesOutOfRange;
+
+    // Display (UI)
+    static Counter displayRefreshes;
+
+    static void start(Configuration* cfg);
+    static void stop();
+
+private:
+    static void serve();
+    static std::string format();
+
+    static int socketFd;
+    static std::string socketPath;
+    static std::thread thread;
+    static std::atomic<bool> running;
+};
+
+#endif
@@ -0,0 +1,488 @@
+/*
+ * A local stand-in for the Brick daemon which simulates the two
+ * Distance IR 2.0 bricklets of each configured instrument. It speaks
+ * enough of the Tinkerforge TCP/IP protocol for SensorInput: identity
+ * queries, the distance getter, the moving average and distance
+ * callback configurations, and periodic distance callbacks.
+ *
+ * The reported distances follow a synthetic curve or a recorded sensor
+ * trace. Responses can be delayed by a fixed latency, random jitter and
+ * occasional long delays in order to examine how the synthesizer's
+ * control loop copes with a slow brickd.
+ *
+ * Reads host, port, sensor UIDs and its own settings (mock_*)
+ * from theresa.cfg.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bricklet_distance_ir_v2.h"
+
+#include "const.h"
+#include "configuration.hpp"
+#include "sensor_trace.hpp"
+
+#define HEADER_SIZE 8
+#define ERROR_CODE_FUNCTION_NOT_SUPPORTED 2
+#define FUNCTION_ENUMERATE 254
+#define CALLBACK_ENUMERATE 253
+
+struct Bricklet {
+    std::string uidString;
+    int channel; // TRACE_CHANNEL_FREQUENCY or TRACE_CHANNEL_VOLUME
+    int minValue;
+    int maxValue;
+
+    uint16_t movingAverageLength = 25;
+
+    uint32_t callbackPeriod = 0;
+    bool valueHasToChange = false;
+    char thresholdOption = 'x';
+    uint16_t thresholdMin = 0;
+    uint16_t thresholdMax = 0;
+    double nextCallbackTime = 0;
+    uint16_t lastCallbackValue = 0;
+};
+
+struct Packet {
+    int clientFd;
+    std::vector<uint8_t> data;
+};
+
+Configuration* cfg;
+std::string curve;
+double curvePeriod;
+SensorTrace trace;
+std::vector<SensorTrace::Reading> traceReadings[TRACE_NUM_CHANNELS];
+uint64_t traceDuration;
+
+double latency;
+double jitter;
+double delayProbability;
+double delay;
+std::mt19937 randomGenerator;
+
+std::map<uint32_t, Bricklet> bricklets;
+std::vector<int> clients;
+std::multimap<double, Packet> pendingPackets; // by due time in ms
+
+std::chrono::steady_clock::time_point startTime;
+
+/*
+ * Milliseconds since the start of the server.
+ */
+double now() {
+    return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - startTime).count();
+}
+
+/*
+ * Decodes a Base58 UID as used by the Tinkerforge bindings.
+ */
+uint32_t decode_uid(std::string uid) {
+
+    const char* alphabet =
+        "123456789abcdefghijkmnopqrstuvwxyzABCDEFGHJKLMNPQRSTUVWXYZ";
+    uint64_t value = 0;
+    for (int i = 0; i < uid.size(); i++) {
+        const char* pos = strchr(alphabet, uid[i]);
+        if (pos == NULL || uid[i] == '\0') {
+            std::cerr << "Invalid UID \"" << uid << "\"." << std::endl;
+            exit(1);
+        }
+        value = value * 58 + (pos - alphabet);
+    }
+    return (uint32_t) value;
+}
+
+void add_bricklet(std::string uid, int channel, int minValue, int maxValue) {
+
+    Bricklet bricklet;
+    bricklet.uidString = uid;
+    bricklet.channel = channel;
+    bricklet.minValue = minValue;
+    bricklet.maxValue = maxValue;
+    bricklets[decode_uid(uid)] = bricklet;
+}
+
+void add_bricklets(Configuration* instrumentCfg) {
+
+    add_bricklet(instrumentCfg->str(UID_FREQUENCY), TRACE_CHANNEL_FREQUENCY,
+            instrumentCfg->i(SENSOR_FREQ_MIN_VALUE),
+            instrumentCfg->i(SENSOR_FREQ_MAX_VALUE));
+    add_bricklet(instrumentCfg->str(UID_VOLUME), TRACE_CHANNEL_VOLUME,
+            instrumentCfg->i(SENSOR_VOL_MIN_VALUE),
+            instrumentCfg->i(SENSOR_VOL_MAX_VALUE));
+}
+
+bool compare_time(const SensorTrace::Reading& a, const SensorTrace::Reading& b) {
+    return a.time < b.time;
+}
+
+/*
+ * The simulated distance of the given bricklet at the given time.
+ */
+uint16_t distance(Bricklet& bricklet, double time) {
+
+    double seconds = time / 1000;
+
+    if (curve == MOCK_CURVE_CONSTANT) {
+        return (bricklet.minValue + bricklet.maxValue) / 2;
+    } else if (curve == MOCK_CURVE_SINE || curve == MOCK_CURVE_RAMP) {
+        // Let the two channels move at different speeds
+        double period = curvePeriod * (bricklet.channel == TRACE_CHANNEL_VOLUME ? 1.5 : 1);
+        double share;
+        if (curve == MOCK_CURVE_SINE) {
+            share = 0.5 + 0.5 * std::sin(2 * M_PI * seconds / period);
+        } else {
+            share = std::fmod(seconds, period) / period;
+        }
+        return bricklet.minValue + share * (bricklet.maxValue - bricklet.minValue);
+    }
+
+    // Loop over the recorded trace with its original timing
+    std::vector<SensorTrace::Reading>& readings = traceReadings[bricklet.channel];
+    SensorTrace::Reading current;
+    current.time = (uint64_t) (time * 1000) % traceDuration;
+    std::vector<SensorTrace::Reading>::iterator next = std::upper_bound(
+            readings.begin(), readings.end(), current, compare_time);
+    if (next == readings.begin()) {
+        return readings.empty() ? bricklet.minValue : readings.back().value;
+    }
+    return (next - 1)->value;
+}
+
+/*
+ * Puts a packet into the queue of outgoing packets,
+ * delayed according to the configured latency and jitter.
+ */
+void send_packet(int clientFd, std::vector<uint8_t>& data) {
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double dueTime = now() + latency + jitter * (2 * uniform(randomGenerator) - 1);
+    if (uniform(randomGenerator) < delayProbability) {
+        dueTime += delay;
+    }
+
+    Packet packet;
+    packet.clientFd = clientFd;
+    packet.data = data;
+    pendingPackets.insert(std::make_pair(std::max(dueTime, now()), packet));
+}
+
+std::vector<uint8_t> create_packet(uint32_t uid, uint8_t functionId,
+        uint8_t sequenceAndOptions, uint8_t errorCode, int payloadSize) {
+
+    std::vector<uint8_t> data(HEADER_SIZE + payloadSize, 0);
+    memcpy(&data[0], &uid, 4);
+    data[4] = HEADER_SIZE + payloadSize;
+    data[5] = functionId;
+    data[6] = sequenceAndOptions;
+    data[7] = errorCode << 6;
+    return data;
+}
+
+/*
+ * Writes the identity of a bricklet as returned by get_identity
+ * and the enumerate callback (25 bytes).
+ */
+void write_identity(uint8_t* payload, Bricklet& bricklet) {
+
+    strncpy((char*) payload, bricklet.uidString.c_str(), 8);
+    strncpy((char*) payload + 8, "0", 8);
+    payload[16] = 'a' + bricklet.channel;
+    uint8_t versions[] = {1, 0, 0, 2, 0, 0};
+    memcpy(payload + 17, versions, 6);
+    uint16_t identifier = DISTANCE_IR_V2_DEVICE_IDENTIFIER;
+    memcpy(payload + 23, &identifier, 2);
+}
+
+void handle_request(int clientFd, uint8_t* request) {
+
+    uint32_t uid;
+    memcpy(&uid, request, 4);
+    uint8_t functionId = request[5];
+    uint8_t sequenceAndOptions = request[6];
+    bool responseExpected = (sequenceAndOptions & 0x08) != 0;
+    uint8_t* payload = request + HEADER_SIZE;
+
+    if (functionId == FUNCTION_ENUMERATE) {
+        std::map<uint32_t, Bricklet>::iterator it;
+        for (it = bricklets.begin(); it != bricklets.end(); ++it) {
+            std::vector<uint8_t> response = create_packet(
+                    it->first, CALLBACK_ENUMERATE, 0, 0, 26);
+            write_identity(&response[HEADER_SIZE], it->second);
+            send_packet(clientFd, response);
+        }
+        return;
+    }
+
+    if (bricklets.count(uid) == 0) {
+        // Unknown device (or the disconnect probe): brickd stays silent
+        return;
+    }
+    Bricklet& bricklet = bricklets[uid];
+
+    std::vector<uint8_t> response;
+    switch (functionId) {
+    case DISTANCE_IR_V2_FUNCTION_GET_IDENTITY:
+        response = create_packet(uid, functionId, sequenceAndOptions, 0, 25);
+        write_identity(&response[HEADER_SIZE], bricklet);
+        break;
+    case DISTANCE_IR_V2_FUNCTION_GET_DISTANCE: {
+        response = create_packet(uid, functionId, sequenceAndOptions, 0, 2);
+        uint16_t value = distance(bricklet, now());
+        memcpy(&response[HEADER_SIZE], &value, 2);
+        break;
+    }
+    case DISTANCE_IR_V2_FUNCTION_SET_MOVING_AVERAGE_CONFIGURATION:
+        memcpy(&bricklet.movingAverageLength, payload, 2);
+        if (responseExpected) {
+            response = create_packet(uid, functionId, sequenceAndOptions, 0, 0);
+        }
+        break;
+    case DISTANCE_IR_V2_FUNCTION_GET_MOVING_AVERAGE_CONFIGURATION:
+        response = create_packet(uid, functionId, sequenceAndOptions, 0, 2);
+        memcpy(&response[HEADER_SIZE], &bricklet.movingAverageLength, 2);
+        break;
+    case DISTANCE_IR_V2_FUNCTION_SET_DISTANCE_CALLBACK_CONFIGURATION:
+        memcpy(&bricklet.callbackPeriod, payload, 4);
+        bricklet.valueHasToChange = payload[4] != 0;
+        bricklet.thresholdOption = payload[5];
+        memcpy(&bricklet.thresholdMin, payload + 6, 2);
+        memcpy(&bricklet.thresholdMax, payload + 8, 2);
+        bricklet.nextCallbackTime = now() + bricklet.callbackPeriod;
+        if (responseExpected) {
+            response = create_packet(uid, functionId, sequenceAndOptions, 0, 0);
+        }
+        break;
+    case DISTANCE_IR_V2_FUNCTION_GET_DISTANCE_CALLBACK_CONFIGURATION:
+        response = create_packet(uid, functionId, sequenceAndOptions, 0, 10);
+        memcpy(&response[HEADER_SIZE], &bricklet.callbackPeriod, 4);
+        response[HEADER_SIZE + 4] = bricklet.valueHasToChange;
+        response[HEADER_SIZE + 5] = bricklet.thresholdOption;
+        memcpy(&response[HEADER_SIZE + 6], &bricklet.thresholdMin, 2);
+        memcpy(&response[HEADER_SIZE + 8], &bricklet.thresholdMax, 2);
+        break;
+    default:
+        if (responseExpected) {
+            response = create_packet(uid, functionId, sequenceAndOptions,
+                    ERROR_CODE_FUNCTION_NOT_SUPPORTED, 0);
+        }
+    }
+
+    if (!response.empty()) {
+        send_packet(clientFd, response);
+    }
+}
+
+/*
+ * Sends distance callbacks to all clients for each bricklet
+ * whose callback period has elapsed.
+ */
+void send_callbacks() {
+
+    double time = now();
+    std::map<uint32_t, Bricklet>::iterator it;
+    for (it = bricklets.begin(); it != bricklets.end(); ++it) {
+
+        Bricklet& bricklet = it->second;
+        if (bricklet.callbackPeriod == 0 || time < bricklet.nextCallbackTime) {
+            continue;
+        }
+        bricklet.nextCallbackTime += bricklet.callbackPeriod;
+
+        uint16_t value = distance(bricklet, time);
+        if (bricklet.valueHasToChange && value == bricklet.lastCallbackValue) {
+            continue;
+        }
+        bool inside = value >= bricklet.thresholdMin && value <= bricklet.thresholdMax;
+        if ((bricklet.thresholdOption == DISTANCE_IR_V2_THRESHOLD_OPTION_OUTSIDE && inside)
+                || (bricklet.thresholdOption == DISTANCE_IR_V2_THRESHOLD_OPTION_INSIDE && !inside)
+                || (bricklet.thresholdOption == DISTANCE_IR_V2_THRESHOLD_OPTION_SMALLER
+                    && value >= bricklet.thresholdMin)
+                || (bricklet.thresholdOption == DISTANCE_IR_V2_THRESHOLD_OPTION_GREATER
+                    && value <= bricklet.thresholdMin)) {
+            continue;
+        }
+        bricklet.lastCallbackValue = value;
+
+        for (int i = 0; i < clients.size(); i++) {
+            std::vector<uint8_t> packet = create_packet(
+                    it->first, DISTANCE_IR_V2_CALLBACK_DISTANCE, 0, 0, 2);
+            memcpy(&packet[HEADER_SIZE], &value, 2);
+            send_packet(clients[i], packet);
+        }
+    }
+}
+
+/*
+ * Writes all packets which are due to their clients.
+ */
+void flush_packets() {
+
+    double time = now();
+    while (!pendingPackets.empty() && pendingPackets.begin()->first <= time) {
+        Packet& packet = pendingPackets.begin()->second;
+        if (write(packet.clientFd, &packet.data[0], packet.data.size()) < 0) {
+            perror("write");
+        }
+        pendingPackets.erase(pendingPackets.begin());
+    }
+}
+
+/*
+ * Reads as many complete requests from a client as possible.
+ * Returns false if the client disconnected.
+ */
+bool read_requests(int clientFd, std::vector<uint8_t>& buffer) {
+
+    uint8_t chunk[1024];
+    int size = read(clientFd, chunk, sizeof(chunk));
+    if (size <= 0) {
+        return false;
+    }
+    buffer.insert(buffer.end(), chunk, chunk + size);
+
+    while (buffer.size() >= HEADER_SIZE && buffer.size() >= buffer[4]) {
+        int length = buffer[4];
+        if (length < HEADER_SIZE) {
+            return false;
+        }
+        handle_request(clientFd, &buffer[0]);
+        buffer.erase(buffer.begin(), buffer.begin() + length);
+    }
+    return true;
+}
+
+int main(int argc, const char* argv[]) {
+
+    cfg = new Configuration();
+    cfg->load();
+
+    curve = cfg->str(MOCK_CURVE);
+    curvePeriod = cfg->d(MOCK_CURVE_PERIOD);
+    latency = cfg->d(MOCK_LATENCY_MS);
+    jitter = cfg->d(MOCK_JITTER_MS);
+    delayProbability = cfg->d(MOCK_DELAY_PROBABILITY);
+    delay = cfg->d(MOCK_DELAY_MS);
+    randomGenerator.seed(1);
+
+    if (curve != MOCK_CURVE_SINE && curve != MOCK_CURVE_RAMP
+            && curve != MOCK_CURVE_CONSTANT) {
+        trace.load(curve);
+        const std::vector<SensorTrace::Reading>& readings = trace.get_readings();
+        if (readings.empty()) {
+            std::cerr << "The sensor trace \"" << curve << "\" is empty." << std::endl;
+            exit(1);
+        }
+        for (int i = 0; i < readings.size(); i++) {
+            traceReadings[readings[i].channel].push_back(readings[i]);
+        }
+        traceDuration = readings.back().time + 1;
+    }
+
+    // Simulate the sensors of every instrument
+    if (cfg->num_entries(ENSEMBLE) > 0) {
+        for (int i = 0; i < cfg->num_entries(ENSEMBLE); i++) {
+            add_bricklets(cfg->entry(ENSEMBLE, i));
+        }
+    } else {
+        add_bricklets(cfg);
+    }
+
+    // Listen for connections
+    struct addrinfo hints;
+    struct addrinfo* address;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    std::string port = std::to_string(cfg->i(PORT));
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (getaddrinfo(cfg->str(HOST).c_str(), port.c_str(), &hints, &address) != 0
+            || bind(listenFd, address->ai_addr, address->ai_addrlen) < 0
+            || listen(listenFd, 8) < 0) {
+        fprintf(stderr, "Could not listen on %s:%s.\n",
+                cfg->str(HOST).c_str(), port.c_str());
+        exit(1);
+    }
+    freeaddrinfo(address);
+
+    std::cout << "Simulating " << bricklets.size() << " bricklets on port "
+            << port << " (latency " << latency << " ms, jitter " << jitter
+            << " ms)." << std::endl;
+
+    startTime = std::chrono::steady_clock::now();
+    std::map<int, std::vector<uint8_t> > buffers;
+
+    while (true) {
+
+        std::vector<struct pollfd> pollFds(clients.size() + 1);
+        pollFds[0].fd = listenFd;
+        pollFds[0].events = POLLIN;
+        for (int i = 0; i < clients.size(); i++) {
+            pollFds[i+1].fd = clients[i];
+            pollFds[i+1].events = POLLIN;
+        }
+
+        // Wake up for the next due packet, and at least every millisecond
+        // for the callbacks
+        int timeout = 1;
+        if (!pendingPackets.empty() && pendingPackets.begin()->first <= now()) {
+            timeout = 0;
+        }
+        poll(&pollFds[0], pollFds.size(), timeout);
+
+        if (pollFds[0].revents & POLLIN) {
+            int clientFd = accept(listenFd, NULL, NULL);
+            if (clientFd >= 0) {
+                int noDelay = 1;
+                setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                clients.push_back(clientFd);
+                std::cout << "Client connected." << std::endl;
+            }
+        }
+        for (int i = 1; i < pollFds.size(); i++) {
+            if (!(pollFds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            int clientFd = pollFds[i].fd;
+            if (!read_requests(clientFd, buffers[clientFd])) {
+                std::cout << "Client disconnected." << std::endl;
+                close(clientFd);
+                buffers.erase(clientFd);
+                clients.erase(std::find(clients.begin(), clients.end(), clientFd));
+                std::multimap<double, Packet>::iterator it = pendingPackets.begin();
+                while (it != pendingPackets.end()) {
+                    if (it->second.clientFd == clientFd) {
+                        pendingPackets.erase(it++);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        }
+
+        send_callbacks();
+        flush_packets();
+    }
+}
@@ -0,0 +1,29 @@
+#include "const.h"
+#include "mouse_input.hpp"
+
+MouseInput::MouseInput(UserInterface* userInterface) {
+    this->userInterface = userInterface;
+}
+
+void MouseInput::setup(Configuration* cfg) {
+    period = 1000.0 / cfg->i(TASK_FREQUENCY_INPUT_MOUSE);
+}
+
+/*
+ * Reports the last known cursor position, which is updated
+ * by the main loop through UserInterface::poll_events().
+ */
+bool MouseInput::read(InputValues* values) {
+
+    float x = 0, y = 0;
+    userInterface->last_cursor_position(&x, &y);
+    values->frequency = y;
+    values->volume = x;
+    values->hasFrequency = true;
+    values->hasVolume = true;
+    return true;
+}
+
+double MouseInput::get_period_millis() {
+    return period;
+}
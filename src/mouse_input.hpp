@@ -0,0 +1,25 @@
+#ifndef THEREMIN_MOUSE_INPUT_H
+#define THEREMIN_MOUSE_INPUT_H
+
+#include "input_device.hpp"
+#include "user_interface.hpp"
+
+/*
+ * Maps the position of the mouse cursor inside the window
+ * to frequency (vertical) and volume (horizontal).
+ */
+class MouseInput : public InputDevice {
+
+public:
+    MouseInput(UserInterface* userInterface);
+
+    void setup(Configuration* cfg);
+    bool read(InputValues* values);
+    double get_period_millis();
+
+private:
+    UserInterface* userInterface;
+    double period;
+};
+
+#endif
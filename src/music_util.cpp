@@ -57,57 +57,6 @@ std::string MusicUtil::get_chord_name(int noteNameIdx, int chordMode, int chordK
     return name;
 }
 
-/*
- * Finds the note (as defined in config.h)
- * which is lower or equals the current frequency, and which has 
- * the smallest distance frequency-wise.
- * Returns the index of this note (a valid index for NOTES and for
- * NOTE_NAMES).
- */
-int MusicUtil::get_nearest_lower_note_index(double frequency) {
-    
-    int lower = 0;
-    int upper = sizeof(NOTE_NAMES)/sizeof(*NOTE_NAMES) - 1;
-    
-    while (upper - lower > 1) {
-        
-        int mid = 0.5 * (lower + upper);
-        
-        if (frequency > NOTES[mid]) {
-            lower = std::max(mid, lower+1);
-        } else if (frequency < NOTES[mid]) {
-            upper = std::min(mid, upper-1);
-        } else {
-            lower = mid; upper = mid;
-        }
-    }
-    
-    return lower;
-}
-
-/*
- * Finds the note which ressembles the current frequency most closely.
- * The corresponding frequency is obtained via NOTES[return_value].
- */
-int MusicUtil::get_nearest_note_index(double frequency) {
-    
-    int lowerNoteIdx = get_nearest_lower_note_index(frequency);
-    double lowerNote = NOTES[lowerNoteIdx];
-    double upperNote = NOTES[lowerNoteIdx + 1];
-    double lowerNoteNorm = 0;
-    double upperNoteNorm = std::log2(upperNote / lowerNote);
-    double currNoteNorm = std::log2(frequency / lowerNote);
-    
-    int noteIdx;
-    if (upperNoteNorm - currNoteNorm > currNoteNorm - lowerNoteNorm) {
-        noteIdx = lowerNoteIdx;
-    } else {
-        noteIdx = lowerNoteIdx + 1;
-    }
-    
-    return noteIdx;
-}
-
 MusicUtil::frequency_correction MusicUtil::get_error_of_frequency(double norm_freq, double lower_norm_freq, double upper_norm_freq) {
     
     frequency_correction correction;
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "const.h"
+#include "osc_input.hpp"
+
+#define OSC_ADDRESS_FREQUENCY "/theresa/frequency"
+#define OSC_ADDRESS_VOLUME "/theresa/volume"
+#define OSC_ADDRESS_MORPH "/theresa/morph"
+#define OSC_ADDRESS_ACTION_PREFIX "/theresa/action/"
+
+/*
+ * Reads a big-endian 32-bit word as OSC transmits it.
+ */
+static uint32_t read_word(const char* data) {
+    uint32_t word;
+    memcpy(&word, data, 4);
+    return ntohl(word);
+}
+
+/*
+ * Returns the size of an OSC string including its padding,
+ * or -1 if the string is not terminated inside the given size.
+ */
+static int padded_string_size(const char* data, int size) {
+    const char* end = (const char*) memchr(data, '\0', size);
+    if (end == NULL) {
+        return -1;
+    }
+    return ((end - data) / 4 + 1) * 4;
+}
+
+/*
+ * Opens the UDP socket to listen for messages on.
+ */
+void OscInput::setup(Configuration* cfg) {
+
+    this->cfg = cfg;
+
+    actionsWritten = 0;
+    actionsRead = 0;
+
+    for (int i = 0; i < sizeof(ACTION_NAMES)/sizeof(*ACTION_NAMES); i++) {
+        std::string name = ACTION_NAMES[i];
+        name = name.substr(name.find('_') + 1);
+        actionAddresses.push_back(OSC_ADDRESS_ACTION_PREFIX + name);
+        actionKeys.push_back(cfg->str(ACTION_NAMES[i]));
+    }
+
+    // Resolve the address to listen on
+    struct addrinfo hints;
+    struct addrinfo* address;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    std::string port = std::to_string(cfg->i(OSC_PORT));
+    if (getaddrinfo(cfg->str(OSC_HOST).c_str(), port.c_str(), &hints, &address) != 0) {
+        fprintf(stderr, "Could not resolve the OSC host \"%s\".\n",
+                cfg->str(OSC_HOST).c_str());
+        exit(1);
+    }
+
+    socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socketFd < 0 || bind(socketFd, address->ai_addr, address->ai_addrlen) < 0) {
+        fprintf(stderr, "Could not listen for OSC messages on port %s.\n",
+                port.c_str());
+        exit(1);
+    }
+    freeaddrinfo(address);
+}
+
+/*
+ * Handles all messages which have arrived, reporting the
+ * last received frequency, volume and morph values.
+ */
+bool OscInput::read(InputValues* values) {
+
+    this->values = values;
+    int size;
+    while ((size = recv(socketFd, packet, sizeof(packet), MSG_DONTWAIT)) > 0) {
+        handle_packet(packet, size);
+    }
+    return values->hasFrequency || values->hasVolume || values->hasMorph;
+}
+
+int OscInput::get_fd() {
+    return socketFd;
+}
+
+bool OscInput::has_actions() {
+    return actionsRead.load(std::memory_order_relaxed)
+            != actionsWritten.load(std::memory_order_acquire);
+}
+
+/*
+ * Appends the triggered actions in the same form as
+ * UserInterface::poll_events(), i.e. as the keys of the actions.
+ */
+void OscInput::poll_actions(std::vector<std::string>& actions) {
+
+    unsigned int read = actionsRead.load(std::memory_order_relaxed);
+    unsigned int written = actionsWritten.load(std::memory_order_acquire);
+    for (; read != written; read++) {
+        actions.push_back(actionKeys[actionRing[read % ACTION_RING_SIZE]]);
+    }
+    actionsRead.store(read, std::memory_order_release);
+}
+
+/*
+ * Handles a single message or a bundle of messages.
+ */
+void OscInput::handle_packet(const char* data, int size) {
+
+    if (size >= 16 && memcmp(data, "#bundle", 8) == 0) {
+        // Skip the time tag, then handle each element
+        int pos = 16;
+        while (pos + 4 <= size) {
+            int elementSize = read_word(data + pos);
+            pos += 4;
+            if (elementSize <= 0 || elementSize > size - pos) {
+                break;
+            }
+            handle_packet(data + pos, elementSize);
+            pos += elementSize;
+        }
+    } else {
+        handle_message(data, size);
+    }
+}
+
+void OscInput::handle_message(const char* data, int size) {
+
+    int addressSize = padded_string_size(data, size);
+    if (addressSize < 0 || addressSize >= size || data[addressSize] != ',') {
+        return;
+    }
+    const char* types = data + addressSize + 1;
+    int typesSize = padded_string_size(data + addressSize, size - addressSize);
+    if (typesSize < 0) {
+        return;
+    }
+    const char* args = data + addressSize + typesSize;
+    int argsSize = size - addressSize - typesSize;
+
+    float value = 1.0f;
+    bool hasValue = read_number(types[0], args, argsSize, &value);
+
+    if (strcmp(data, OSC_ADDRESS_FREQUENCY) == 0) {
+        if (hasValue) {
+            values->frequency = value;
+            values->hasFrequency = true;
+        }
+    } else if (strcmp(data, OSC_ADDRESS_VOLUME) == 0) {
+        if (hasValue) {
+            values->volume = value;
+            values->hasVolume = true;
+        }
+    } else if (strcmp(data, OSC_ADDRESS_MORPH) == 0) {
+        if (hasValue) {
+            values->morph = value;
+            values->hasMorph = true;
+        }
+    } else if (strncmp(data, OSC_ADDRESS_ACTION_PREFIX,
+                       strlen(OSC_ADDRESS_ACTION_PREFIX)) == 0) {
+        if (value == 0) {
+            return;
+        }
+        for (int i = 0; i < actionAddresses.size(); i++) {
+            if (strcmp(data, actionAddresses[i].c_str()) == 0) {
+                push_action(i);
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * Interprets the first argument of a message as a number.
+ * Returns false if there is no such argument.
+ */
+bool OscInput::read_number(char type, const char* data, int size, float* value) {
+
+    if (type == 'f' && size >= 4) {
+        uint32_t word = read_word(data);
+        memcpy(value, &word, 4);
+    } else if (type == 'i' && size >= 4) {
+        *value = (int32_t) read_word(data);
+    } else if (type == 'd' && size >= 8) {
+        uint64_t word = ((uint64_t) read_word(data) << 32) | read_word(data + 4);
+        double d;
+        memcpy(&d, &word, 8);
+        *value = d;
+    } else if (type == 'T') {
+        *value = 1;
+    } else if (type == 'F') {
+        *value = 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void OscInput::push_action(int actionIdx) {
+
+    unsigned int written = actionsWritten.load(std::memory_order_relaxed);
+    if (written - actionsRead.load(std::memory_order_acquire) >= ACTION_RING_SIZE) {
+        // The main loop did not keep up, drop the action
+        return;
+    }
+    actionRing[written % ACTION_RING_SIZE] = actionIdx;
+    actionsWritten.store(written + 1, std::memory_order_release);
+}
+
+/*
+ * Stops listening and closes the socket.
+ */
+void OscInput::finish() {
+    close(socketFd);
+}
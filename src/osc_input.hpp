@@ -0,0 +1,59 @@
+#ifndef THEREMIN_OSC_INPUT_H
+#define THEREMIN_OSC_INPUT_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "configuration.hpp"
+#include "input_device.hpp"
+
+/*
+ * Receives OSC messages via UDP and offers their contents to the
+ * main loop. Understood addresses are
+ *   /theresa/frequency <float in [0,1]>
+ *   /theresa/volume <float in [0,1]>
+ *   /theresa/morph <float in [0,1]>
+ *   /theresa/action/<name> [<number>]
+ * where <name> is the name of an action in the configuration without
+ * its "action_" prefix (e.g. /theresa/action/tremolo). Actions with an
+ * argument equal to zero are ignored, such that buttons may send 1/0.
+ * Messages are parsed in place without any allocations.
+ */
+class OscInput : public InputDevice {
+
+public:
+    void setup(Configuration* cfg);
+    void finish();
+
+    bool read(InputValues* values);
+    int get_fd();
+    bool has_actions();
+    void poll_actions(std::vector<std::string>& actions);
+
+private:
+    void handle_packet(const char* data, int size);
+    void handle_message(const char* data, int size);
+    bool read_number(char type, const char* data, int size, float* value);
+    void push_action(int actionIdx);
+
+    Configuration* cfg;
+    int socketFd;
+
+    char packet[1536];
+
+    // Addresses of the actions and the keys they correspond to
+    std::vector<std::string> actionAddresses;
+    std::vector<std::string> actionKeys;
+
+    // Values of the packets which are currently being read
+    InputValues* values;
+
+    // Single-producer, single-consumer ring of triggered action indices
+    static const int ACTION_RING_SIZE = MAX_POLLED_ACTIONS;
+    int actionRing[ACTION_RING_SIZE];
+    std::atomic<unsigned int> actionsWritten;
+    std::atomic<unsigned int> actionsRead;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+
+#include "const.h"
+#include "output_scheduler.hpp"
+#include "metrics.hpp"
+#include "timeline.hpp"
+
+/*
+ * Sets up the bounds of the queue. The capacity is the maximal number
+ * of samples the backend can hold, or non-positive if unbounded.
+ */
+void OutputScheduler::setup(Configuration* cfg, int blockSize, int sampleRate,
+                            int capacity) {
+
+    this->blockSize = blockSize;
+    blockMicros = 1e6 * blockSize / sampleRate;
+    maxBlocks = std::max(1, cfg->i(AUDIO_QUEUE_MAX_BLOCKS));
+    if (capacity > 0) {
+        maxBlocks = std::min(maxBlocks, std::max(1, capacity / blockSize));
+    }
+    minBlocks = std::min(std::max(1, cfg->i(AUDIO_QUEUE_MIN_BLOCKS)), maxBlocks);
+    shrinkAfterMicros = cfg->d(AUDIO_QUEUE_SHRINK_AFTER) * 1e6;
+    targetBlocks = minBlocks;
+    Metrics::targetBlocks.set(targetBlocks);
+}
+
+/*
+ * True if the next block should be written, given the number of samples
+ * still queued at the backend (negative for backends without a queue).
+ */
+bool OutputScheduler::is_ready(int queuedSamples) {
+    return queuedSamples <= (targetBlocks - 1) * blockSize;
+}
+
+/*
+ * To be called as soon as a block is completely rendered.
+ */
+void OutputScheduler::block_rendered() {
+    Metrics::blocksRendered.add();
+    if (lastWriteTime > 0) {
+        int64_t now = now_micros();
+        renderMicros = now - lastWriteTime;
+        Timeline::record("render block", lastWriteTime * 1000, now * 1000);
+        Metrics::blockRenderSeconds.observe(renderMicros / 1e6);
+        Metrics::renderLoad.set(renderMicros / blockMicros);
+    }
+}
+
+/*
+ * To be called after writing a block, with the number of samples
+ * which were queued right before. Adapts the target.
+ */
+void OutputScheduler::block_written(int queuedSamples) {
+
+    int64_t now = now_micros();
+    lastWriteTime = now;
+    if (queuedSamples < 0) {
+        return;
+    }
+    Metrics::queuedSamples.set(queuedSamples);
+    if (!started) {
+        // The queue is empty before the first block anyway
+        started = true;
+        windowStart = now;
+        return;
+    }
+
+    if (queuedSamples == 0) {
+        underruns++;
+        Metrics::underruns.add();
+        if (targetBlocks < maxBlocks) {
+            set_target(targetBlocks + 1);
+        }
+        windowStart = now;
+        maxRenderMicros = 0;
+        return;
+    }
+
+    // With one block less, the slowest block would have had to render
+    // within the time which (targetBlocks - 2) queued blocks play
+    maxRenderMicros = std::max(maxRenderMicros, renderMicros);
+    if (now - windowStart >= shrinkAfterMicros) {
+        if (targetBlocks > minBlocks
+                && maxRenderMicros < 0.5 * (targetBlocks - 2) * blockMicros) {
+            set_target(targetBlocks - 1);
+        }
+        windowStart = now;
+        maxRenderMicros = 0;
+    }
+}
+
+int OutputScheduler::get_target_blocks() {
+    return targetBlocks;
+}
+
+int OutputScheduler::get_underruns() {
+    return underruns;
+}
+
+/*
+ * The latency of the queue at its target depth.
+ */
+double OutputScheduler::get_latency_millis() {
+    return targetBlocks * blockMicros / 1000;
+}
+
+double OutputScheduler::get_max_render_millis() {
+    return std::max(maxRenderMicros, renderMicros) / 1000.0;
+}
+
+/*
+ * Called from the audio path: the new target is only reported through
+ * the metrics, which are exported off the realtime thread.
+ */
+void OutputScheduler::set_target(int blocks) {
+
+    targetBlocks = blocks;
+    Metrics::targetBlocks.set(blocks);
+}
+
+int64_t OutputScheduler::now_micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,54 @@
+#ifndef THEREMIN_OUTPUT_SCHEDULER_H
+#define THEREMIN_OUTPUT_SCHEDULER_H
+
+#include <stdint.h>
+
+#include "configuration.hpp"
+
+/*
+ * Decides when Audio hands the next block to the backend, keeping a
+ * target number of blocks queued at the device. It counts underruns
+ * (the queue having run empty before a write) and measures the time
+ * needed to render each block. After an underrun, the target grows by
+ * one block; after a quiet period in which even the slowest block
+ * rendered well within the headroom of a smaller queue, it shrinks by
+ * one block. The target stays within the configured bounds and the
+ * capacity of the backend.
+ */
+class OutputScheduler {
+
+public:
+    void setup(Configuration* cfg, int blockSize, int sampleRate, int capacity);
+
+    bool is_ready(int queuedSamples);
+    void block_rendered();
+    void block_written(int queuedSamples);
+
+    int get_target_blocks();
+    int get_underruns();
+    double get_latency_millis();
+    double get_max_render_millis();
+
+private:
+    static int64_t now_micros();
+    void set_target(int blocks);
+
+    int blockSize;
+    double blockMicros;
+    int minBlocks;
+    int maxBlocks;
+    int targetBlocks;
+    int64_t shrinkAfterMicros;
+
+    bool started = false;
+    int underruns = 0;
+
+    // Rendering time of the current block, and its maximum since the
+    // last change of the target (the window deciding about shrinking)
+    int64_t lastWriteTime = 0;
+    int64_t renderMicros = 0;
+    int64_t maxRenderMicros = 0;
+    int64_t windowStart = 0;
+};
+
+#endif
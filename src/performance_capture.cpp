@@ -0,0 +1,258 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#include "performance_capture.hpp"
+
+static const char CAPTURE_MAGIC[] = "THPC";
+static const uint8_t CAPTURE_VERSION = 1;
+
+// Interval in which the writing thread empties the ring
+#define CAPTURE_WRITE_MS 50
+
+/*
+ * Reads an unsigned LEB128 varint, returns false at the end of the file.
+ */
+static bool read_varint(FILE* in, uint64_t* value) {
+
+    *value = 0;
+    int shift = 0;
+    int byte;
+    do {
+        byte = fgetc(in);
+        if (byte == EOF || shift > 63) {
+            return false;
+        }
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return true;
+}
+
+PerformanceCapture::~PerformanceCapture() {
+
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        thread.join();
+    }
+}
+
+/*
+ * Creates the given file and writes all events passed to record()
+ * and record_action() into it from now on. The times of the events
+ * are given in samples at the given rate.
+ */
+void PerformanceCapture::start_recording(std::string filename, int sampleRate) {
+
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL) {
+        std::cerr << "Could not create performance capture \"" << filename
+                << "\"." << std::endl;
+        exit(1);
+    }
+    this->sampleRate = sampleRate;
+    fwrite(CAPTURE_MAGIC, 1, 4, file);
+    fwrite(&CAPTURE_VERSION, 1, 1, file);
+    write_varint(sampleRate);
+
+    // Values are stored as differences to zero at first
+    for (int i = 0; i < PERFORMANCE_NUM_TYPES; i++) {
+        hasRecorded[i] = false;
+        lastWritten[i] = 0;
+    }
+    lastWrittenTime = 0;
+    recording = true;
+    thread = std::thread(&PerformanceCapture::run, this);
+}
+
+/*
+ * Records a new input value within [0,1] of the given type, unless it
+ * is the same as the previous one after quantization.
+ */
+void PerformanceCapture::record(int type, double value, uint64_t time) {
+
+    if (!recording) {
+        return;
+    }
+    value = std::min(std::max(value, 0.0), 1.0);
+    uint16_t quantized = (uint16_t) std::round(value * UINT16_MAX);
+    if (hasRecorded[type] && lastRecorded[type] == quantized) {
+        return;
+    }
+    hasRecorded[type] = true;
+    lastRecorded[type] = quantized;
+    push(type, quantized, time);
+}
+
+/*
+ * Records an action given by its index in ACTION_NAMES.
+ */
+void PerformanceCapture::record_action(int actionIdx, uint64_t time) {
+
+    if (recording) {
+        push(PERFORMANCE_ACTION, actionIdx, time);
+    }
+}
+
+/*
+ * Writes the remaining events and the end of the performance
+ * at the given time, and closes the file.
+ */
+void PerformanceCapture::stop_recording(uint64_t time) {
+
+    if (!recording) {
+        return;
+    }
+    recording = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    thread.join();
+
+    write_events();
+    Event end = {time, PERFORMANCE_END, 0};
+    write_event(end);
+    fclose(file);
+    file = NULL;
+
+    if (dropped > 0) {
+        std::cerr << "Warning: " << dropped << " events of the performance "
+                << "could not be captured in time." << std::endl;
+    }
+}
+
+/*
+ * Passes an event to the writing thread, or drops it if
+ * the thread did not keep up.
+ */
+void PerformanceCapture::push(int type, uint16_t value, uint64_t time) {
+
+    unsigned int written = eventsWritten.load(std::memory_order_relaxed);
+    if (written - eventsRead.load(std::memory_order_acquire) >= EVENT_RING_SIZE) {
+        dropped++;
+        return;
+    }
+    eventRing[written % EVENT_RING_SIZE] = {time, (uint8_t) type, value};
+    eventsWritten.store(written + 1, std::memory_order_release);
+}
+
+void PerformanceCapture::run() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wakeup.wait_for(lock, std::chrono::milliseconds(CAPTURE_WRITE_MS));
+        lock.unlock();
+        write_events();
+        lock.lock();
+    }
+}
+
+/*
+ * Writes all events which are waiting in the ring.
+ */
+void PerformanceCapture::write_events() {
+
+    unsigned int read = eventsRead.load(std::memory_order_relaxed);
+    unsigned int written = eventsWritten.load(std::memory_order_acquire);
+    for (; read != written; read++) {
+        write_event(eventRing[read % EVENT_RING_SIZE]);
+    }
+    eventsRead.store(read, std::memory_order_release);
+}
+
+void PerformanceCapture::write_event(const Event& event) {
+
+    fputc(event.type, file);
+    write_varint(event.time - lastWrittenTime);
+    lastWrittenTime = event.time;
+
+    if (event.type == PERFORMANCE_ACTION || event.type == PERFORMANCE_END) {
+        write_varint(event.value);
+        return;
+    }
+    // Zigzag encoding, such that small steps in
+    // either direction take a single byte
+    int32_t difference = (int32_t) event.value - lastWritten[event.type];
+    write_varint(((uint32_t) difference << 1) ^ (uint32_t) (difference >> 31));
+    lastWritten[event.type] = event.value;
+}
+
+void PerformanceCapture::write_varint(uint64_t value) {
+
+    uint8_t bytes[10];
+    int size = 0;
+    do {
+        bytes[size] = value & 0x7f;
+        value >>= 7;
+        if (value != 0) {
+            bytes[size] |= 0x80;
+        }
+        size++;
+    } while (value != 0);
+    fwrite(bytes, 1, size, file);
+}
+
+/*
+ * Reads all events of the given capture file into memory.
+ */
+void PerformanceCapture::load(std::string filename) {
+
+    FILE* in = fopen(filename.c_str(), "rb");
+    char header[5];
+    uint64_t rate;
+    if (in == NULL || fread(header, 1, 5, in) != 5
+            || memcmp(header, CAPTURE_MAGIC, 4) != 0
+            || header[4] != CAPTURE_VERSION
+            || !read_varint(in, &rate) || rate == 0) {
+        std::cerr << "Could not read performance capture \"" << filename
+                << "\"." << std::endl;
+        exit(1);
+    }
+    sampleRate = rate;
+
+    events.clear();
+    uint64_t time = 0;
+    uint16_t values[PERFORMANCE_NUM_TYPES] = {0};
+    int type;
+    while ((type = fgetc(in)) != EOF) {
+
+        uint64_t delta, value;
+        if (type >= PERFORMANCE_NUM_TYPES || !read_varint(in, &delta)
+                || !read_varint(in, &value)) {
+            std::cerr << "Warning: Performance capture \"" << filename
+                    << "\" is truncated or corrupt." << std::endl;
+            break;
+        }
+        time += delta;
+        if (type != PERFORMANCE_ACTION && type != PERFORMANCE_END) {
+            int32_t difference = (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+            value = values[type] + difference;
+            values[type] = value;
+        }
+
+        Event event;
+        event.time = time;
+        event.type = type;
+        event.value = value;
+        events.push_back(event);
+        if (type == PERFORMANCE_END) {
+            break;
+        }
+    }
+    fclose(in);
+}
+
+int PerformanceCapture::get_sample_rate() {
+    return sampleRate;
+}
+
+const std::vector<PerformanceCapture::Event>& PerformanceCapture::get_events() {
+    return events;
+}
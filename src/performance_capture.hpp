@@ -0,0 +1,90 @@
+#ifndef THEREMIN_PERFORMANCE_CAPTURE_H
+#define THEREMIN_PERFORMANCE_CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define PERFORMANCE_FREQUENCY 0
+#define PERFORMANCE_VOLUME 1
+#define PERFORMANCE_MORPH 2
+#define PERFORMANCE_ACTION 3
+#define PERFORMANCE_END 4
+#define PERFORMANCE_NUM_TYPES 5
+
+/*
+ * A recording of the control events of a performance, i.e. of what
+ * the synthesizer is told to play rather than of the audio, such that
+ * it can be rendered again offline (see theresa_render --performance).
+ *
+ * File format: the magic bytes "THPC", a format version byte and the
+ * sample rate of the performance (unsigned LEB128 varint), and then one
+ * record per event consisting of the event type (1 byte), the samples
+ * since the previous event (varint) and the value (varint). Input values
+ * (frequency, volume, morph position) are quantized to 16 bits and
+ * stored as the zigzag-encoded difference to the previous value of the
+ * same type; actions are stored as their index in ACTION_NAMES. The
+ * last record marks the end of the performance.
+ *
+ * record() is safe to call from the audio path: events are passed
+ * through a lock-free ring to a thread which writes the file.
+ */
+class PerformanceCapture {
+
+public:
+    struct Event {
+        uint64_t time; // samples since the beginning of the performance
+        uint8_t type;
+        uint16_t value;
+    };
+
+    ~PerformanceCapture();
+
+    void start_recording(std::string filename, int sampleRate);
+    void record(int type, double value, uint64_t time);
+    void record_action(int actionIdx, uint64_t time);
+    void stop_recording(uint64_t time);
+
+    void load(std::string filename);
+    int get_sample_rate();
+    const std::vector<Event>& get_events();
+
+private:
+    void push(int type, uint16_t value, uint64_t time);
+    void run();
+    void write_events();
+    void write_event(const Event& event);
+    void write_varint(uint64_t value);
+
+    int sampleRate;
+
+    // Recording
+    FILE* file = NULL;
+    bool recording = false;
+    bool hasRecorded[PERFORMANCE_NUM_TYPES];
+    uint16_t lastRecorded[PERFORMANCE_NUM_TYPES];
+    uint64_t lastWrittenTime;
+    uint16_t lastWritten[PERFORMANCE_NUM_TYPES];
+    std::atomic<unsigned int> dropped{0};
+
+    // Single-producer, single-consumer ring of events to write
+    static const int EVENT_RING_SIZE = 4096;
+    Event eventRing[EVENT_RING_SIZE];
+    std::atomic<unsigned int> eventsWritten{0};
+    std::atomic<unsigned int> eventsRead{0};
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    // Replaying
+    std::vector<Event> events;
+};
+
+#endif
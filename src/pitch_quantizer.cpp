@@ -0,0 +1,168 @@
+#include <cmath>
+#include <algorithm>
+
+#include "const.h"
+#include "pitch_quantizer.hpp"
+
+void PitchQuantizer::init(Configuration* cfg, const Tuning& tuning,
+                          int lowestNoteIdx, double numOctaves) {
+
+    this->cfg = cfg;
+    this->tuning = tuning;
+    this->lowestNoteIdx = lowestNoteIdx;
+    this->numOctaves = numOctaves;
+
+    mode = mode_of(cfg->str(AUTOTUNE_MODE));
+    strength = std::min(1.0, std::max(0.0, cfg->d(AUTOTUNE_STRENGTH)));
+
+    // Find the index of the scale's root inside the lowest octave
+    std::string root = cfg->str(AUTOTUNE_ROOT);
+    rootIdx = -1;
+    for (int i = 0; i < 12; i++) {
+        std::string name = NOTE_NAMES[i];
+        if (name.substr(0, name.length() - 1) == root) {
+            rootIdx = i;
+            break;
+        }
+    }
+    if (rootIdx < 0) {
+        std::cerr << "Error: Invalid autotune root \"" << root << "\"." << std::endl;
+        exit(1);
+    }
+
+    set_scale(cfg->str(AUTOTUNE_SCALE));
+}
+
+/*
+ * Switches to the table of the given autotune mode.
+ * Safe to call from the audio path.
+ */
+void PitchQuantizer::set_mode(std::string mode) {
+    this->mode = mode_of(mode);
+}
+
+PitchQuantizer::Mode PitchQuantizer::mode_of(std::string mode) {
+
+    if (mode == AUTOTUNE_NONE) {
+        return NONE;
+    } else if (mode == AUTOTUNE_SMOOTH) {
+        return SMOOTH;
+    }
+    return FULL;
+}
+
+/*
+ * Sets the scale which the autotune modes will approach,
+ * transposed to the configured root note.
+ */
+void PitchQuantizer::set_scale(std::string scale) {
+
+    std::vector<double> intervals;
+    if (scale == SCALE_CHROMATIC) {
+        intervals = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    } else if (scale == SCALE_MAJOR) {
+        intervals = {0, 2, 4, 5, 7, 9, 11};
+    } else if (scale == SCALE_MINOR) {
+        intervals = {0, 2, 3, 5, 7, 8, 10};
+    } else if (scale == SCALE_PENTATONIC) {
+        intervals = {0, 2, 4, 7, 9};
+    } else if (scale == SCALE_CUSTOM) {
+        intervals = cfg->d_list(AUTOTUNE_CUSTOM_SCALE);
+    }
+    if (intervals.empty()) {
+        std::cerr << "Error: Invalid autotune scale \"" << scale << "\"." << std::endl;
+        exit(1);
+    }
+
+    degrees.clear();
+    for (int i = 0; i < intervals.size(); i++) {
+        double degree = std::fmod(intervals[i] + rootIdx, 12.0);
+        if (degree < 0) {
+            degree += 12.0;
+        }
+        degrees.push_back(degree);
+    }
+    std::sort(degrees.begin(), degrees.end());
+    degrees.erase(std::unique(degrees.begin(), degrees.end()), degrees.end());
+
+    for (int m = 0; m < NUM_MODES; m++) {
+        build_table((Mode) m);
+    }
+}
+
+/*
+ * Returns the (corrected) frequency which lies the given amount of octaves
+ * above the lowest note. Inside the playable range (including the octave
+ * offset), this is a linear interpolation between two table entries.
+ */
+double PitchQuantizer::frequency_at(double octaves) {
+
+    const std::vector<double>& values = tables[mode];
+    double pos = octaves * 12 * STEPS_PER_SEMITONE;
+    if (pos < 0 || pos >= values.size() - 1) {
+        // Outside of the precomputed range
+        return frequency_of_semitones(quantize_semitones(
+                    lowestNoteIdx + 12 * octaves, mode));
+    }
+
+    int idx = (int) pos;
+    double share = pos - idx;
+    return values[idx] + share * (values[idx+1] - values[idx]);
+}
+
+/*
+ * Precomputes the correction curve of the given mode from the lowest
+ * note up to the highest note which can be reached with the octave offset.
+ */
+void PitchQuantizer::build_table(Mode mode) {
+
+    int size = (int) std::ceil((numOctaves + 1) * 12 * STEPS_PER_SEMITONE) + 2;
+    std::vector<double>& values = tables[mode];
+    values.resize(size);
+    for (int i = 0; i < size; i++) {
+        double semitones = lowestNoteIdx + (double) i / STEPS_PER_SEMITONE;
+        values[i] = frequency_of_semitones(quantize_semitones(semitones, mode));
+    }
+}
+
+/*
+ * Applies the autotune correction to a pitch given as semitones above
+ * the lowest defined note. In smooth mode, a pitch tends to approach the
+ * next proper note of the scale (but all pitches inbetween are possible
+ * as well); in full mode, it is pulled onto the nearest note of the scale.
+ */
+double PitchQuantizer::quantize_semitones(double semitones, Mode mode) {
+
+    if (mode == NONE || degrees.empty()) {
+        return semitones;
+    }
+
+    double octave = std::floor(semitones / 12) * 12;
+    double rel = semitones - octave;
+
+    // Find the neighboring scale degrees
+    double lower = degrees.back() - 12;
+    double upper = degrees.front();
+    for (int i = 0; i < degrees.size(); i++) {
+        if (degrees[i] <= rel) {
+            lower = degrees[i];
+            upper = (i + 1 < degrees.size() ? degrees[i+1] : degrees.front() + 12);
+        }
+    }
+    double gap = upper - lower;
+    double share = (rel - lower) / gap;
+
+    double corrected;
+    if (mode == SMOOTH) {
+        corrected = lower + gap * (share
+                - strength * std::sin(2 * M_PI * share) / (2 * M_PI));
+    } else /*if (mode == FULL)*/ {
+        double nearest = (share < 0.5 ? lower : upper);
+        corrected = rel + strength * (nearest - rel);
+    }
+    return octave + corrected;
+}
+
+double PitchQuantizer::frequency_of_semitones(double semitones) {
+    return tuning.frequency_at(semitones);
+}
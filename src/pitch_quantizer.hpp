@@ -0,0 +1,56 @@
+#ifndef THEREMIN_PITCH_QUANTIZER_H
+#define THEREMIN_PITCH_QUANTIZER_H
+
+#include <string>
+#include <vector>
+
+#include "configuration.hpp"
+#include "tuning.hpp"
+
+/*
+ * Maps positions on the playable pitch range to (auto-tuned) frequencies.
+ * The correction curve of each autotune mode for the scale is precomputed
+ * into a table in the logarithmic frequency domain, such that each
+ * frequency update only costs a table lookup and switching the mode (e.g.
+ * by a key press on the audio path) only selects another table. Pitches
+ * are counted in notes of the instrument's tuning, i.e. in semitones of
+ * the equal temperament.
+ */
+class PitchQuantizer {
+
+public:
+    void init(Configuration* cfg, const Tuning& tuning, int lowestNoteIdx, double numOctaves);
+
+    void set_mode(std::string mode);
+    void set_scale(std::string scale);
+
+    double frequency_at(double octaves);
+
+private:
+    enum Mode { NONE, SMOOTH, FULL, NUM_MODES };
+
+    static Mode mode_of(std::string mode);
+    void build_table(Mode mode);
+    double quantize_semitones(double semitones, Mode mode);
+    double frequency_of_semitones(double semitones);
+
+    Configuration* cfg;
+    Tuning tuning;
+
+    Mode mode;
+    double strength;
+    int rootIdx;
+
+    // Scale degrees in semitones above C, sorted, inside [0,12)
+    std::vector<double> degrees;
+
+    int lowestNoteIdx;
+    double numOctaves;
+
+    // Corrected frequency for each table step above the lowest note,
+    // per mode (the current one is selected by its index)
+    std::vector<double> tables[NUM_MODES];
+    static const int STEPS_PER_SEMITONE = 64;
+};
+
+#endif
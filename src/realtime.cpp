@@ -0,0 +1,119 @@
+#include <iostream>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "realtime.hpp"
+
+// Stack which is touched in advance by each real-time thread
+#define PREFAULT_STACK_SIZE (256 * 1024)
+
+/*
+ * Keeps all memory of the process resident: locks the pages mapped
+ * now and in the future, keeps the allocator from returning freed
+ * memory to the system, and pre-faults the stack of the calling thread.
+ * Buffers allocated up to now have been written at least once and
+ * thus are locked as well.
+ */
+void Realtime::lock_memory() {
+
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+        report("locking memory", 0);
+    } else {
+        int errCode = errno;
+        struct rlimit limit;
+        std::string note;
+        if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+            note = "limit of " + std::to_string(limit.rlim_cur / 1024) + " KiB, see ulimit -l";
+        }
+        report("locking memory", errCode, note);
+    }
+    prefault_stack();
+}
+
+/*
+ * Gives the thread the given SCHED_FIFO priority (if positive)
+ * and pins it to the given core (if non-negative).
+ */
+void Realtime::setup_thread(pthread_t thread, std::string name,
+                            int priority, int core) {
+
+    if (priority > 0) {
+        int granted;
+        int errCode = set_priority(thread, priority, &granted);
+        std::string note;
+        if (errCode == 0 && granted < priority) {
+            note = "limited by RLIMIT_RTPRIO";
+        } else if (errCode != 0) {
+            note = "keeping the default scheduling";
+        }
+        report(name + " thread: SCHED_FIFO priority " + std::to_string(granted),
+               errCode, note);
+    }
+    if (core >= 0) {
+        report(name + " thread: pinning to core " + std::to_string(core),
+               pin_to_core(thread, core));
+    }
+}
+
+/*
+ * Touches the next PREFAULT_STACK_SIZE bytes of the calling
+ * thread's stack, such that it will not fault while rendering.
+ */
+void Realtime::prefault_stack() {
+
+    char stack[PREFAULT_STACK_SIZE];
+    memset(stack, 0, PREFAULT_STACK_SIZE);
+    // Keep the compiler from dropping the unused writes
+    asm volatile("" : : "r" (stack) : "memory");
+}
+
+/*
+ * Switches the thread to SCHED_FIFO. Without the privilege for the
+ * requested priority, retries with the highest one permitted by
+ * RLIMIT_RTPRIO. Returns the error code of the last attempt.
+ */
+int Realtime::set_priority(pthread_t thread, int priority, int* granted) {
+
+    struct sched_param param;
+    param.sched_priority = priority;
+    *granted = priority;
+    int errCode = pthread_setschedparam(thread, SCHED_FIFO, &param);
+
+    struct rlimit limit;
+    if (errCode == EPERM && getrlimit(RLIMIT_RTPRIO, &limit) == 0
+            && limit.rlim_cur > 0 && limit.rlim_cur < (rlim_t) priority) {
+        param.sched_priority = limit.rlim_cur;
+        *granted = limit.rlim_cur;
+        errCode = pthread_setschedparam(thread, SCHED_FIFO, &param);
+    }
+    return errCode;
+}
+
+/*
+ * Restricts the given thread to run on a single core.
+ */
+int Realtime::pin_to_core(pthread_t thread, int core) {
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    return pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuSet);
+}
+
+void Realtime::report(std::string measure, int errCode, std::string note) {
+
+    std::cout << "Real-time: " << measure << ": "
+            << (errCode == 0 ? "applied" : std::string("failed (") + strerror(errCode) + ")");
+    if (!note.empty()) {
+        std::cout << ", " << note;
+    }
+    std::cout << std::endl;
+}
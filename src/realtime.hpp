@@ -0,0 +1,28 @@
+#ifndef THEREMIN_REALTIME_H
+#define THEREMIN_REALTIME_H
+
+#include <pthread.h>
+#include <string>
+
+/*
+ * Measures to keep the audio path from being preempted or stalled
+ * by page faults: real-time scheduling and pinning of threads, and
+ * locking of memory. Each measure is attempted on its own and its
+ * outcome is reported on stdout; whatever is not permitted is
+ * skipped, keeping the default behaviour.
+ */
+class Realtime {
+
+public:
+    static void lock_memory();
+    static void setup_thread(pthread_t thread, std::string name,
+                             int priority, int core);
+    static void prefault_stack();
+
+private:
+    static int set_priority(pthread_t thread, int priority, int* granted);
+    static int pin_to_core(pthread_t thread, int core);
+    static void report(std::string measure, int errCode, std::string note = "");
+};
+
+#endif
@@ -0,0 +1,440 @@
+/*
+ * Offline renderer of the synthesizer, without any audio device or
+ * sensors: plays a fixed frequency and volume sweep with each waveform
+ * and writes the result into a WAV file. Also measures the rendering
+ * speed (--bench) and compares the output with a reference rendering
+ * (--compare), e.g. of the fixed-point against the floating-point build;
+ * with --tolerance, it fails if the RMS error of any waveform exceeds
+ * the given one. A tolerance given as <waveform>=<rms> applies to that
+ * waveform only, overriding the plain one, since waveforms with jumps
+ * differ far more than smooth ones. --max-volume overrides max_volume of the configuration.
+ * With --device-rate, the rendering is resampled to that rate as by the
+ * audio output stage, and the benchmark compares the cost of resampling
+ * with the cost of rendering at the device rate in the first place
+ * (extrapolated from the measured cost per rendered sample).
+ *
+ * With --performance, a captured performance (see performance_capture)
+ * is rendered instead, at the given rate (48000 Hz by default): the
+ * synthesizer and the effects run at a multiple of it (--oversample,
+ * 4 by default), and the result is decimated by the resampler with
+ * its longest filter. The capture holds no settings: the performance
+ * is rendered with the current theresa.cfg (except for the sample
+ * rate), which should be the one it was played with.
+ *
+ * Usage: theresa_render [--bench] [--seconds <per waveform>]
+ *                       [--device-rate <Hz>] [--max-volume <volume>]
+ *                       [--compare <reference.wav>
+ *                        [--tolerance [<waveform>=]<rms>]...]
+ *                       [<output.wav>]
+ *        theresa_render --performance <capture> [--rate <Hz>]
+ *                       [--oversample <factor>] [--bench] <output.wav>
+ *                       (with the theresa.cfg of the performance)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "const.h"
+#include "configuration.hpp"
+#include "wave_synth.hpp"
+#include "resampler.hpp"
+#include "effects_chain.hpp"
+#include "performance_capture.hpp"
+
+#define WAV_HEADER_SIZE 44
+
+// Filter taps of the decimation of a performance, the most
+// the resampler is meant to be configured with
+#define PERFORMANCE_TAPS 128
+// Time after the end of a performance in which the effects may
+// ring out, in seconds
+#define PERFORMANCE_TAIL 2.0
+
+static void write_u32(FILE* file, uint32_t value) {
+    uint8_t bytes[4] = {(uint8_t) value, (uint8_t) (value >> 8),
+                        (uint8_t) (value >> 16), (uint8_t) (value >> 24)};
+    fwrite(bytes, 1, 4, file);
+}
+
+static void write_u16(FILE* file, uint16_t value) {
+    uint8_t bytes[2] = {(uint8_t) value, (uint8_t) (value >> 8)};
+    fwrite(bytes, 1, 2, file);
+}
+
+/*
+ * Creates a 16-bit mono WAV file, whose sizes are
+ * filled in by finish_wav() once all samples are written.
+ */
+static FILE* create_wav(std::string path, int sampleRate) {
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        std::cerr << "Could not write \"" << path << "\"." << std::endl;
+        exit(1);
+    }
+    fwrite("RIFF", 1, 4, file);
+    write_u32(file, 0);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_u32(file, 16);
+    write_u16(file, 1); // PCM
+    write_u16(file, 1); // mono
+    write_u32(file, sampleRate);
+    write_u32(file, sampleRate * 2);
+    write_u16(file, 2);
+    write_u16(file, 16);
+    fwrite("data", 1, 4, file);
+    write_u32(file, 0);
+    return file;
+}
+
+static void finish_wav(FILE* file, uint32_t numSamples) {
+
+    uint32_t dataSize = numSamples * 2;
+    fseek(file, 4, SEEK_SET);
+    write_u32(file, 36 + dataSize);
+    fseek(file, WAV_HEADER_SIZE - 4, SEEK_SET);
+    write_u32(file, dataSize);
+    fclose(file);
+}
+
+/*
+ * Writes the samples (unsigned, as returned by WaveSynth::wave())
+ * as a 16-bit mono WAV file.
+ */
+static void write_wav(std::string path, const std::vector<uint16_t>& samples,
+                      int sampleRate) {
+
+    FILE* file = create_wav(path, sampleRate);
+    for (int i = 0; i < samples.size(); i++) {
+        write_u16(file, samples[i] ^ 0x8000); // to signed
+    }
+    finish_wav(file, samples.size());
+}
+
+/*
+ * Resamples the samples in blocks of the given size, as Audio does.
+ */
+static std::vector<uint16_t> resample(const std::vector<uint16_t>& samples,
+                                      int inputRate, int outputRate, int taps,
+                                      int blockSize) {
+
+    Resampler resampler;
+    resampler.setup(inputRate, outputRate, taps, blockSize);
+    std::vector<float> block(blockSize);
+    std::vector<float> output(resampler.max_output_size(blockSize));
+    std::vector<uint16_t> result;
+
+    for (int start = 0; start < samples.size(); start += blockSize) {
+        int inputSize = std::min(blockSize, (int) samples.size() - start);
+        for (int i = 0; i < inputSize; i++) {
+            block[i] = (float) samples[start + i] / UINT16_MAX;
+        }
+        int size = resampler.process(&block[0], inputSize, &output[0]);
+        for (int i = 0; i < size; i++) {
+            float value = std::min(std::max(output[i], 0.0f), 1.0f);
+            result.push_back((uint16_t) (value * UINT16_MAX + 0.5f));
+        }
+    }
+    return result;
+}
+
+/*
+ * Reads a WAV file as written by write_wav().
+ */
+static std::vector<uint16_t> read_wav(std::string path) {
+
+    std::vector<uint16_t> samples;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL || fseek(file, WAV_HEADER_SIZE, SEEK_SET) != 0) {
+        std::cerr << "Could not read \"" << path << "\"." << std::endl;
+        exit(1);
+    }
+    uint8_t bytes[2];
+    while (fread(bytes, 1, 2, file) == 2) {
+        samples.push_back((bytes[0] | (bytes[1] << 8)) ^ 0x8000);
+    }
+    fclose(file);
+    return samples;
+}
+
+/*
+ * Applies a captured event to the synthesizer or, for the
+ * tremolo, to the effects.
+ */
+static void apply_event(const PerformanceCapture::Event& event, WaveSynth& synth,
+                        EffectsChain& effects, Configuration* cfg) {
+
+    double value = (double) event.value / UINT16_MAX;
+    if (event.type == PERFORMANCE_FREQUENCY) {
+        synth.update_frequency(value);
+    } else if (event.type == PERFORMANCE_VOLUME) {
+        synth.update_volume(value);
+    } else if (event.type == PERFORMANCE_MORPH) {
+        synth.set_morph_position(value);
+    } else if (event.type == PERFORMANCE_ACTION
+            && event.value < sizeof(ACTION_NAMES)/sizeof(*ACTION_NAMES)) {
+        std::string action = ACTION_NAMES[event.value];
+        if (action == ACTION_TREMOLO) {
+            effects.set_enabled(EFFECT_TREMOLO, !effects.is_enabled(EFFECT_TREMOLO));
+        } else {
+            synth.apply_action(cfg->str(ACTION_NAMES[event.value]));
+        }
+    }
+}
+
+/*
+ * Renders a captured performance into a WAV file at the output rate,
+ * running the synthesizer and the effects at oversample times that rate.
+ */
+static void render_performance(Configuration* cfg, std::string capturePath,
+                               std::string outputPath, int outputRate,
+                               int oversample, bool bench) {
+
+    PerformanceCapture capture;
+    capture.load(capturePath);
+    const std::vector<PerformanceCapture::Event>& events = capture.get_events();
+    int captureRate = capture.get_sample_rate();
+    int rate = outputRate * oversample;
+
+    // The volume changes by a step per sample, which shrinks
+    // such that it keeps its speed at the higher rate
+    double volumeChange = cfg->d(MAX_VOLUME_CHANGE_PER_TICK);
+    cfg->set(SAMPLE_RATE, rate);
+    cfg->set(MAX_VOLUME_CHANGE_PER_TICK, volumeChange * captureRate / rate);
+
+    WaveSynth synth;
+    synth.init(cfg);
+    int blockSize = cfg->i(BUFFER_SIZE) * oversample;
+    EffectsChain effects;
+    effects.setup(cfg, blockSize);
+    Resampler decimator;
+    std::vector<float> output(blockSize);
+    if (oversample > 1) {
+        decimator.setup(rate, outputRate, PERFORMANCE_TAPS, blockSize);
+        output.resize(decimator.max_output_size(blockSize));
+    }
+
+    uint64_t end = events.empty() ? 0 : events.back().time;
+    uint64_t numSamples = (uint64_t) (((double) end / captureRate + PERFORMANCE_TAIL) * rate);
+    std::vector<float> block(blockSize);
+    FILE* file = create_wav(outputPath, outputRate);
+    uint32_t written = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    int eventIdx = 0;
+    for (uint64_t n = 0; n < numSamples; ) {
+        int size = std::min((uint64_t) blockSize, numSamples - n);
+        for (int i = 0; i < size; i++, n++) {
+            // Events apply from the first sample at their time
+            while (eventIdx < events.size()
+                    && events[eventIdx].time * rate <= n * captureRate) {
+                apply_event(events[eventIdx++], synth, effects, cfg);
+            }
+            block[i] = (float) synth.wave(n + 1) / UINT16_MAX;
+            synth.volume_tick();
+        }
+
+        // The same output stage as for the audio device
+        effects.process(&block[0], size);
+        int outputSize = size;
+        if (oversample > 1) {
+            outputSize = decimator.process(&block[0], size, &output[0]);
+        } else {
+            std::copy(block.begin(), block.begin() + size, output.begin());
+        }
+        for (int i = 0; i < outputSize; i++) {
+            float value = std::min(std::max(output[i], -1.0f), 1.0f);
+            write_u16(file, (uint16_t) (int16_t) (value * INT16_MAX));
+        }
+        written += outputSize;
+    }
+    finish_wav(file, written);
+
+    if (bench) {
+        double elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        double rendered = (double) written / outputRate;
+        printf("Rendered %.1f s of the performance at %d Hz (oversampled %dx) "
+               "in %.3f s (%.2f%% of realtime).\n", rendered, outputRate,
+               oversample, elapsed, 100 * elapsed / rendered);
+    }
+}
+
+int main(int argc, const char* argv[]) {
+
+    bool bench = false;
+    double seconds = 2;
+    int deviceRate = 0;
+    std::string comparePath;
+    std::string outputPath;
+    std::string performancePath;
+    int outputRate = 48000;
+    int oversample = 4;
+    int maxVolume = 0;
+    double tolerance = -1;
+    std::map<std::string, double> waveformTolerances;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--seconds" && i+1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (arg == "--device-rate" && i+1 < argc) {
+            deviceRate = atoi(argv[++i]);
+        } else if (arg == "--compare" && i+1 < argc) {
+            comparePath = argv[++i];
+        } else if (arg == "--tolerance" && i+1 < argc) {
+            std::string value = argv[++i];
+            size_t separator = value.find('=');
+            if (separator == std::string::npos) {
+                tolerance = atof(value.c_str());
+            } else {
+                waveformTolerances[value.substr(0, separator)]
+                        = atof(value.c_str() + separator + 1);
+            }
+        } else if (arg == "--max-volume" && i+1 < argc) {
+            maxVolume = atoi(argv[++i]);
+        } else if (arg == "--performance" && i+1 < argc) {
+            performancePath = argv[++i];
+        } else if (arg == "--rate" && i+1 < argc) {
+            outputRate = atoi(argv[++i]);
+        } else if (arg == "--oversample" && i+1 < argc) {
+            oversample = atoi(argv[++i]);
+        } else {
+            outputPath = arg;
+        }
+    }
+
+    Configuration* cfg = new Configuration();
+    cfg->load();
+    if (maxVolume > 0) {
+        cfg->set(MAX_VOLUME, maxVolume);
+    }
+
+    if (!performancePath.empty()) {
+        if (outputPath.empty() || outputRate <= 0 || oversample < 1) {
+            std::cerr << "Rendering a performance needs an output file, "
+                    "a valid rate and an oversampling factor of at least 1."
+                    << std::endl;
+            exit(1);
+        }
+        render_performance(cfg, performancePath, outputPath,
+                           outputRate, oversample, bench);
+        delete cfg;
+        return 0;
+    }
+
+    WaveSynth synth;
+    synth.init(cfg);
+
+    int sampleRate = cfg->i(SAMPLE_RATE);
+    int periodInput = sampleRate / cfg->i(TASK_FREQUENCY_INPUT_SENSOR);
+    int samplesPerWaveform = seconds * sampleRate;
+    int numWaveforms = synth.get_num_waveforms();
+
+    std::vector<uint16_t> samples(numWaveforms * samplesPerWaveform);
+    std::vector<std::string> waveforms;
+
+    auto start = std::chrono::steady_clock::now();
+
+    int t = 1;
+    for (int w = 0; w < numWaveforms; w++) {
+        waveforms.push_back(synth.get_waveform());
+        for (int i = 0; i < samplesPerWaveform; i++) {
+
+            // Sweep through the whole range of frequencies and volumes
+            if ((t - 1) % periodInput == 0) {
+                double time = (double) t / sampleRate;
+                synth.update_frequency(0.5 + 0.5 * std::sin(2 * M_PI * time / 3.0));
+                synth.update_volume(0.6 + 0.3 * std::sin(2 * M_PI * time / 1.3));
+            }
+
+            samples[w * samplesPerWaveform + i] = synth.wave(t);
+            synth.volume_tick();
+            t++;
+        }
+        synth.switch_waveform();
+    }
+
+    double elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+#ifdef THEREMIN_FIXED_POINT
+    std::string build = "fixed-point";
+#else
+    std::string build = "floating-point";
+#endif
+
+    if (bench) {
+        double rendered = (double) samples.size() / sampleRate;
+        printf("Rendered %.1f s of audio in %.3f s with the %s build "
+               "(%.2f%% of realtime).\n", rendered, elapsed, build.c_str(),
+               100 * elapsed / rendered);
+    }
+
+    if (deviceRate > 0 && deviceRate != sampleRate) {
+
+        start = std::chrono::steady_clock::now();
+        samples = resample(samples, sampleRate, deviceRate,
+                           cfg->i(RESAMPLER_TAPS), cfg->i(BUFFER_SIZE));
+        double resampling = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        samplesPerWaveform = (long) samplesPerWaveform * deviceRate / sampleRate;
+
+        if (bench) {
+            double direct = elapsed * deviceRate / sampleRate;
+            printf("Rendering at %d Hz plus resampling to %d Hz takes %.3f s "
+                   "(resampling: %.3f s); rendering at %d Hz directly would "
+                   "take about %.3f s.\n", sampleRate, deviceRate,
+                   elapsed + resampling, resampling, deviceRate, direct);
+        }
+        sampleRate = deviceRate;
+    }
+
+    if (!comparePath.empty()) {
+        std::vector<uint16_t> reference = read_wav(comparePath);
+        if (reference.size() != samples.size()) {
+            std::cerr << "The reference has a different length." << std::endl;
+            exit(1);
+        }
+        printf("%-12s %10s %10s\n", "waveform", "max error", "rms error");
+        bool exceeded = false;
+        for (int w = 0; w < numWaveforms; w++) {
+            int maxError = 0;
+            double sumSquares = 0;
+            for (int i = w * samplesPerWaveform; i < (w+1) * samplesPerWaveform; i++) {
+                int error = std::abs(samples[i] - reference[i]);
+                maxError = std::max(maxError, error);
+                sumSquares += (double) error * error;
+            }
+            double rmsError = std::sqrt(sumSquares / samplesPerWaveform);
+            double limit = tolerance;
+            if (waveformTolerances.count(waveforms[w])) {
+                limit = waveformTolerances[waveforms[w]];
+            }
+            bool exceeds = (limit >= 0 && rmsError > limit);
+            printf("%-12s %10d %10.2f%s\n", waveforms[w].c_str(), maxError, rmsError,
+                   exceeds ? "  (exceeds tolerance)" : "");
+            exceeded |= exceeds;
+        }
+        if (exceeded) {
+            delete cfg;
+            return 1;
+        }
+    }
+
+    if (!outputPath.empty()) {
+        write_wav(outputPath, samples, sampleRate);
+    }
+
+    delete cfg;
+}
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#include "resampler.hpp"
+
+// Stopband attenuation of the filter in dB
+#define RESAMPLER_ATTENUATION 80.0
+
+static int gcd(int a, int b) {
+    return b == 0 ? a : gcd(b, a % b);
+}
+
+/*
+ * Modified Bessel function of the first kind and order zero,
+ * as needed for the Kaiser window.
+ */
+static double bessel_i0(double x) {
+
+    double sum = 1;
+    double term = 1;
+    for (int k = 1; term > 1e-12 * sum; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/*
+ * Prepares the conversion of blocks of up to maxBlockSize samples.
+ * More taps give a steeper filter, i.e. a wider passband, at a
+ * linearly higher cost per output sample.
+ */
+void Resampler::setup(int inputRate, int outputRate, int taps, int maxBlockSize) {
+
+    int divisor = gcd(inputRate, outputRate);
+    up = outputRate / divisor;
+    down = inputRate / divisor;
+    if (up > MAX_PHASES) {
+        std::cerr << "Error: Cannot resample from " << inputRate << " Hz to "
+                << outputRate << " Hz, as the ratio " << up << "/" << down
+                << " would need more than " << MAX_PHASES << " filter phases."
+                << std::endl;
+        exit(1);
+    }
+    this->taps = taps;
+    design_filter(inputRate, outputRate);
+
+    history.assign(taps - 1 + maxBlockSize, 0);
+    position = 0;
+    phase = 0;
+
+    std::cout << "Resampling from " << inputRate << " Hz to " << outputRate
+            << " Hz (" << up << "/" << down << ", " << taps << " taps)." << std::endl;
+}
+
+/*
+ * A low-pass filter at the upsampled rate, cutting off below the lower
+ * of both Nyquist frequencies, as a Kaiser-windowed sinc. The transition
+ * band follows from the length of the filter (Kaiser's estimate).
+ */
+void Resampler::design_filter(int inputRate, int outputRate) {
+
+    int length = taps * up;
+    double upsampledRate = (double) inputRate * up;
+    double nyquist = 0.5 * std::min(inputRate, outputRate);
+    double transition = (RESAMPLER_ATTENUATION - 8) * upsampledRate
+            / (2.285 * 2 * M_PI * (length - 1));
+    double cutoff = std::max(0.5 * nyquist, nyquist - 0.5 * transition);
+    double beta = 0.1102 * (RESAMPLER_ATTENUATION - 8.7);
+
+    std::vector<double> prototype(length);
+    double center = 0.5 * (length - 1);
+    for (int n = 0; n < length; n++) {
+        double x = 2 * cutoff / upsampledRate * (n - center);
+        double sinc = (x == 0) ? 1 : std::sin(M_PI * x) / (M_PI * x);
+        double ratio = (n - center) / center;
+        double window = bessel_i0(beta * std::sqrt(std::max(0.0, 1 - ratio * ratio)))
+                / bessel_i0(beta);
+        prototype[n] = sinc * window;
+    }
+
+    // Each phase is normalized to unity gain, such that a constant
+    // signal stays constant instead of being modulated with the phases
+    coefficients.resize(up * taps);
+    for (int p = 0; p < up; p++) {
+        double sum = 0;
+        for (int k = 0; k < taps; k++) {
+            sum += prototype[p + k * up];
+        }
+        for (int k = 0; k < taps; k++) {
+            coefficients[p * taps + (taps - 1 - k)] = prototype[p + k * up] / sum;
+        }
+    }
+}
+
+/*
+ * Converts a block of samples, writing up to max_output_size(size)
+ * samples to the output. Returns the number of samples written.
+ * Samples of the previous block are kept as the history of the filter.
+ */
+int Resampler::process(const float* input, int size, float* output) {
+
+    memcpy(&history[taps - 1], input, size * sizeof(float));
+
+    int written = 0;
+    while (position < size) {
+
+        const float* c = &coefficients[phase * taps];
+        const float* x = &history[position];
+        float sum = 0;
+        for (int k = 0; k < taps; k++) {
+            sum += c[k] * x[k];
+        }
+        output[written++] = sum;
+
+        phase += down;
+        position += phase / up;
+        phase %= up;
+    }
+
+    memmove(&history[0], &history[size], (taps - 1) * sizeof(float));
+    position -= size;
+    return written;
+}
+
+int Resampler::max_output_size(int inputSize) {
+    return (int) (((long) inputSize * up + down - 1) / down) + 1;
+}
@@ -0,0 +1,43 @@
+#ifndef THEREMIN_RESAMPLER_H
+#define THEREMIN_RESAMPLER_H
+
+#include <vector>
+
+/*
+ * Converts a stream of blocks between two sample rates with a polyphase
+ * windowed-sinc filter. The ratio of the rates is reduced to L/M: the
+ * stream is conceptually upsampled by L, low-pass filtered and decimated
+ * by M, but only the L phases of the filter which fall onto output
+ * samples are ever evaluated, each being a dot product of a fixed number
+ * of taps with the most recent input samples. The coefficients of all
+ * phases are precomputed, such that process() neither allocates nor
+ * calls any math functions.
+ */
+class Resampler {
+
+public:
+    static const int MAX_PHASES = 1024;
+
+    void setup(int inputRate, int outputRate, int taps, int maxBlockSize);
+    int process(const float* input, int size, float* output);
+    int max_output_size(int inputSize);
+
+private:
+    void design_filter(int inputRate, int outputRate);
+
+    int taps;
+    int up;   // L
+    int down; // M
+
+    // Coefficients per phase, reversed such that they are applied
+    // to the input history in ascending order
+    std::vector<float> coefficients;
+
+    // The last (taps-1) input samples followed by the current block
+    std::vector<float> history;
+    // Position of the next output sample in the history and its phase
+    int position = 0;
+    int phase = 0;
+};
+
+#endif
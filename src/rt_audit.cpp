@@ -0,0 +1,286 @@
+#ifdef THEREMIN_RT_AUDIT
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <atomic>
+#include <new>
+
+#include "rt_audit.hpp"
+
+// glibc's own allocator, which the replacements below forward to
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+#define MAX_SITES 64
+#define MAX_FRAMES 16
+// Frames of the audit itself on top of each backtrace
+#define SKIPPED_FRAMES 2
+
+/*
+ * A distinct place where the audio path violated real-time safety.
+ */
+struct Site {
+    const char* kind;
+    void* frames[MAX_FRAMES];
+    int numFrames;
+    std::atomic<long> count;
+};
+
+static Site sites[MAX_SITES];
+static std::atomic<int> numSites(0);
+static std::atomic<long> numUnrecorded(0);
+static std::atomic_flag sitesLock = ATOMIC_FLAG_INIT;
+
+// Depth of nested scopes on this thread, and whether the current
+// violation is being recorded (which must not count itself)
+static thread_local int auditDepth = 0;
+static thread_local bool recording = false;
+
+// Original definitions of the functions replaced below
+static int (*originalMutexLock)(pthread_mutex_t*);
+static ssize_t (*originalRead)(int, void*, size_t);
+static ssize_t (*originalWrite)(int, const void*, size_t);
+static size_t (*originalFwrite)(const void*, size_t, size_t, FILE*);
+static int (*originalPutc)(int, FILE*);
+static int (*originalNanosleep)(const struct timespec*, struct timespec*);
+static int (*originalUsleep)(useconds_t);
+
+/*
+ * Looks up the original definition of a function replaced below.
+ */
+template<typename Function>
+static Function next_definition(Function* cache, const char* name) {
+    if (*cache == NULL) {
+        *cache = (Function) dlsym(RTLD_NEXT, name);
+    }
+    return *cache;
+}
+
+RtAudit::Scope::Scope() {
+    auditDepth++;
+}
+
+RtAudit::Scope::~Scope() {
+    auditDepth--;
+}
+
+/*
+ * Resolves the functions replaced below and loads everything which
+ * backtrace() needs, such that the audit does not allocate later on.
+ */
+void RtAudit::enable() {
+
+    void* frames[MAX_FRAMES];
+    backtrace(frames, MAX_FRAMES);
+    next_definition(&originalMutexLock, "pthread_mutex_lock");
+    next_definition(&originalRead, "read");
+    next_definition(&originalWrite, "write");
+    next_definition(&originalFwrite, "fwrite");
+    next_definition(&originalPutc, "putc");
+    next_definition(&originalNanosleep, "nanosleep");
+    next_definition(&originalUsleep, "usleep");
+    fprintf(stderr, "Real-time audit enabled.\n");
+}
+
+/*
+ * Records a violation of the given kind if the calling
+ * thread is on the audio path.
+ */
+__attribute__((noinline)) void RtAudit::check(const char* kind) {
+
+    if (auditDepth == 0 || recording) {
+        return;
+    }
+    recording = true;
+
+    void* frames[MAX_FRAMES + SKIPPED_FRAMES];
+    int numFrames = backtrace(frames, MAX_FRAMES + SKIPPED_FRAMES) - SKIPPED_FRAMES;
+    if (numFrames < 0) {
+        numFrames = 0;
+    }
+
+    while (sitesLock.test_and_set(std::memory_order_acquire));
+
+    bool found = false;
+    int n = numSites.load(std::memory_order_relaxed);
+    for (int i = 0; i < n && !found; i++) {
+        if (sites[i].kind == kind && sites[i].numFrames == numFrames
+                && memcmp(sites[i].frames, frames + SKIPPED_FRAMES,
+                          numFrames * sizeof(void*)) == 0) {
+            sites[i].count++;
+            found = true;
+        }
+    }
+    if (!found && n < MAX_SITES) {
+        sites[n].kind = kind;
+        sites[n].numFrames = numFrames;
+        memcpy(sites[n].frames, frames + SKIPPED_FRAMES, numFrames * sizeof(void*));
+        sites[n].count = 1;
+        numSites.store(n + 1, std::memory_order_relaxed);
+    } else if (!found) {
+        numUnrecorded++;
+    }
+
+    sitesLock.clear(std::memory_order_release);
+    recording = false;
+}
+
+/*
+ * Lists all violations with the backtraces of their call sites.
+ */
+void RtAudit::report() {
+
+    int n = numSites.load();
+    if (n == 0) {
+        fprintf(stderr, "Real-time audit: no violations on the audio path.\n");
+        return;
+    }
+    fprintf(stderr, "Real-time audit: %d call sites violated real-time "
+            "safety on the audio path.\n", n);
+    for (int i = 0; i < n; i++) {
+        fprintf(stderr, "\n[%d] %s, %ld times:\n", i + 1, sites[i].kind,
+                sites[i].count.load());
+        fflush(stderr);
+        backtrace_symbols_fd(sites[i].frames, sites[i].numFrames, fileno(stderr));
+    }
+    if (numUnrecorded > 0) {
+        fprintf(stderr, "\n%ld further violations at other call sites.\n",
+                numUnrecorded.load());
+    }
+}
+
+/*
+ * Replacements of the allocator
+ */
+
+void* operator new(size_t size) {
+    RtAudit::check("operator new");
+    void* ptr = __libc_malloc(size);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    RtAudit::check("operator new[]");
+    void* ptr = __libc_malloc(size);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    RtAudit::check("operator new");
+    return __libc_malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    RtAudit::check("operator new[]");
+    return __libc_malloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr != NULL) {
+        RtAudit::check("operator delete");
+    }
+    __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    if (ptr != NULL) {
+        RtAudit::check("operator delete[]");
+    }
+    __libc_free(ptr);
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+    RtAudit::check("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+    RtAudit::check("calloc");
+    return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    RtAudit::check("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    RtAudit::check("posix_memalign");
+    *ptr = __libc_memalign(alignment, size);
+    return (*ptr == NULL ? ENOMEM : 0);
+}
+
+void free(void* ptr) {
+    if (ptr != NULL) {
+        RtAudit::check("free");
+    }
+    __libc_free(ptr);
+}
+
+/*
+ * Replacements of locks and blocking calls
+ */
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    RtAudit::check("pthread_mutex_lock");
+    return next_definition(&originalMutexLock, "pthread_mutex_lock")(mutex);
+}
+
+ssize_t read(int fd, void* buf, size_t count) {
+    RtAudit::check("read");
+    return next_definition(&originalRead, "read")(fd, buf, count);
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+    RtAudit::check("write");
+    return next_definition(&originalWrite, "write")(fd, buf, count);
+}
+
+// Output through stdio (and thus std::cout) does not call write()
+// by its exported name, so it is checked where it enters the library
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream) {
+    RtAudit::check("fwrite");
+    return next_definition(&originalFwrite, "fwrite")(ptr, size, count, stream);
+}
+
+int putc(int c, FILE* stream) {
+    RtAudit::check("putc");
+    return next_definition(&originalPutc, "putc")(c, stream);
+}
+
+int nanosleep(const struct timespec* duration, struct timespec* remaining) {
+    RtAudit::check("nanosleep");
+    return next_definition(&originalNanosleep, "nanosleep")(duration, remaining);
+}
+
+int usleep(useconds_t usec) {
+    RtAudit::check("usleep");
+    return next_definition(&originalUsleep, "usleep")(usec);
+}
+
+}
+
+#endif
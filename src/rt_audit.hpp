@@ -0,0 +1,38 @@
+#ifndef THEREMIN_RT_AUDIT_H
+#define THEREMIN_RT_AUDIT_H
+
+/*
+ * Real-time safety audit (debug builds with THEREMIN_RT_AUDIT only).
+ *
+ * Code on the audio path is marked by placing a Scope on the stack.
+ * While a thread is inside such a scope, every call to operator
+ * new/delete, malloc and friends, pthread_mutex_lock and blocking I/O
+ * (read, write, stdio output, sleeping) counts as a violation: each
+ * distinct call site is recorded with its backtrace and listed by
+ * report() at program exit. Without THEREMIN_RT_AUDIT, all of this
+ * compiles to nothing.
+ */
+class RtAudit {
+
+public:
+    class Scope {
+    public:
+#ifdef THEREMIN_RT_AUDIT
+        Scope();
+        ~Scope();
+#else
+        Scope() {}
+#endif
+    };
+
+#ifdef THEREMIN_RT_AUDIT
+    static void enable();
+    static void report();
+    static void check(const char* kind);
+#else
+    static void enable() {}
+    static void report() {}
+#endif
+};
+
+#endif
@@ -1,16 +1,37 @@
 #include <stdio.h>
+#include <iostream>
 #include <functional>
+#include <chrono>
+#include <algorithm>
 
 #include "const.h"
 #include "sensor_input.hpp"
+#include "metrics.hpp"
 
 /*
  * Connects to the sensor brick and to the
  * two expected distance sensors.
+ * If the input device is a sensor trace, no connection is made
+ * and the trace's readings are reported instead.
  */
-void SensorInput::setup_sensors(Configuration* cfg) {
+void SensorInput::setup(Configuration* cfg) {
     
     this->cfg = cfg;
+    period = 1000.0 / cfg->i(TASK_FREQUENCY_INPUT_SENSOR);
+    
+    if (cfg->str(INPUT_DEVICE) == INPUT_DEVICE_TRACE) {
+        trace.load(cfg->str(SENSOR_TRACE_REPLAY));
+        trace.start_replaying(cfg->b(SENSOR_TRACE_REALTIME));
+        replaying = true;
+        if (!cfg->b(SENSOR_TRACE_REALTIME)) {
+            // One reading per sensor poll of the rendered audio
+            periodSamples = std::max(1, cfg->i(SAMPLE_RATE)
+                    / cfg->i(TASK_FREQUENCY_INPUT_SENSOR));
+        }
+        std::cout << "Replaying sensor trace with " 
+                << trace.get_readings().size() << " readings." << std::endl;
+        return;
+    }
     
     // Create IP connection
     ipcon_create(&ipcon);
@@ -31,6 +52,67 @@ void SensorInput::setup_sensors(Configuration* cfg) {
     // Turn off moving average (because it causes higher latency)
     distance_ir_v2_set_moving_average_configuration(&distanceFrequency, 1);
     distance_ir_v2_set_moving_average_configuration(&distanceVolume, 1);
+    
+    if (!cfg->str(SENSOR_TRACE_RECORD).empty()) {
+        trace.start_recording(cfg->str(SENSOR_TRACE_RECORD));
+        recording = true;
+    }
+}
+
+/*
+ * Polls the raw value of the given channel (TRACE_CHANNEL_FREQUENCY
+ * or TRACE_CHANNEL_VOLUME) from the according sensor or from the 
+ * replayed trace. Returns false if there is no value.
+ */
+bool SensorInput::raw_value(int channel, uint16_t* rawValue) {
+    
+    if (replaying) {
+        return trace.next(channel, rawValue);
+    }
+    
+    DistanceIRV2* sensor = (channel == TRACE_CHANNEL_FREQUENCY ? 
+                &distanceFrequency : &distanceVolume);
+    auto start = std::chrono::steady_clock::now();
+    int result = distance_ir_v2_get_distance(sensor, rawValue);
+    Metrics::sensorReadSeconds.observe(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count());
+    if (result < 0) {
+        return false;
+    }
+    if (recording) {
+        trace.record(channel, *rawValue);
+    }
+    return true;
+}
+
+/*
+ * Polls both sensors.
+ */
+bool SensorInput::read(InputValues* values) {
+    
+    values->hasVolume = volume_value(&values->volume);
+    values->hasFrequency = frequency_value(&values->frequency);
+    return values->hasVolume || values->hasFrequency;
+}
+
+double SensorInput::get_period_millis() {
+    return period;
+}
+
+/*
+ * A trace which is not replayed in realtime is read once per sensor
+ * period of played samples, such that it plays back the same way
+ * however fast the audio is rendered.
+ */
+int SensorInput::get_period_samples() {
+    return periodSamples;
+}
+
+/*
+ * Returns true if a replayed trace has no more readings.
+ */
+bool SensorInput::is_finished() {
+    return replaying && trace.is_finished();
 }
 
 /*
@@ -43,7 +125,10 @@ bool SensorInput::frequency_value(double* value) {
     
     // Poll value from sensor
     uint16_t rawValue = 0;
-    distance_ir_v2_get_distance(&distanceFrequency, &rawValue);
+    if (!raw_value(TRACE_CHANNEL_FREQUENCY, &rawValue)) {
+        Metrics::frequencyValuesDropped.add();
+        return false;
+    }
     
     if (rawValue <= cfg->i(SENSOR_FREQ_MAX_VALUE)) {
         // normalize the value to [0,1]
@@ -52,6 +137,7 @@ bool SensorInput::frequency_value(double* value) {
         return true;
     } else {        
         // do not report values over the threshold
+        Metrics::frequencyValuesOutOfRange.add();
         return false;
     }
 }
@@ -66,7 +152,9 @@ bool SensorInput::volume_value(double* value) {
     
     // Poll value from sensor
     uint16_t rawValue = 0;
-    distance_ir_v2_get_distance(&distanceVolume, &rawValue);
+    if (!raw_value(TRACE_CHANNEL_VOLUME, &rawValue)) {
+        return false;
+    }
     
     // cap values at the threshold
     if (rawValue >= cfg->i(SENSOR_VOL_MAX_VALUE)) {
@@ -84,6 +172,10 @@ bool SensorInput::volume_value(double* value) {
  */
 void SensorInput::finish() {
     
+    if (replaying) {
+        return;
+    }
+    trace.stop_recording();
     distance_ir_v2_destroy(&distanceFrequency);
     distance_ir_v2_destroy(&distanceVolume);
     ipcon_destroy(&ipcon); // Calls ipcon_disconnect internally
@@ -5,12 +5,23 @@
 #include "bricklet_distance_ir_v2.h"
 
 #include "configuration.hpp"
+#include "input_device.hpp"
+#include "sensor_trace.hpp"
 
-class SensorInput {
+/*
+ * Input by two Tinkerforge distance sensors, or by a replayed 
+ * trace of their readings.
+ */
+class SensorInput : public InputDevice {
 
 public:
-    void setup_sensors(Configuration* cfg);
+    void setup(Configuration* cfg);
     void finish();
+    bool read(InputValues* values);
+    double get_period_millis();
+    int get_period_samples();
+    bool is_finished();
+    
     bool frequency_value(double* value);
     bool volume_value(double* value);
     
@@ -18,8 +29,19 @@ public:
     DistanceIRV2 distanceVolume;
     
 private:
+    bool raw_value(int channel, uint16_t* rawValue);
+    
     Configuration* cfg;
     IPConnection ipcon;
+    double period;
+    
+    // Recording of the readings, or replayed readings 
+    // which take the place of the actual sensors
+    SensorTrace trace;
+    bool recording = false;
+    bool replaying = false;
+    // Samples per reading of a trace which is not replayed in realtime
+    int periodSamples = 0;
     
 };
 
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <string.h>
+
+#include "sensor_trace.hpp"
+
+static const char TRACE_MAGIC[] = "THST";
+static const uint8_t TRACE_VERSION = 1;
+
+/*
+ * Creates the given file and writes all readings
+ * passed to record() into it from now on.
+ */
+void SensorTrace::start_recording(std::string filename) {
+
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL) {
+        std::cerr << "Could not create sensor trace \"" << filename
+                << "\"." << std::endl;
+        exit(1);
+    }
+    fwrite(TRACE_MAGIC, 1, 4, file);
+    fwrite(&TRACE_VERSION, 1, 1, file);
+
+    startTime = std::chrono::steady_clock::now();
+    lastRecordTime = 0;
+}
+
+void SensorTrace::record(int channel, uint16_t value) {
+
+    if (file == NULL) {
+        return;
+    }
+
+    uint64_t time = elapsed_micros();
+    uint64_t delta = time - lastRecordTime;
+    lastRecordTime = time;
+
+    uint8_t record[3 + 10];
+    int size = 0;
+    record[size++] = channel;
+    record[size++] = value & 0xff;
+    record[size++] = value >> 8;
+    do {
+        record[size] = delta & 0x7f;
+        delta >>= 7;
+        if (delta != 0) {
+            record[size] |= 0x80;
+        }
+        size++;
+    } while (delta != 0);
+    fwrite(record, 1, size, file);
+}
+
+void SensorTrace::stop_recording() {
+
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+/*
+ * Reads all readings of the given trace file into memory.
+ */
+void SensorTrace::load(std::string filename) {
+
+    FILE* in = fopen(filename.c_str(), "rb");
+    char header[5];
+    if (in == NULL || fread(header, 1, 5, in) != 5
+            || memcmp(header, TRACE_MAGIC, 4) != 0
+            || header[4] != TRACE_VERSION) {
+        std::cerr << "Could not read sensor trace \"" << filename
+                << "\"." << std::endl;
+        exit(1);
+    }
+
+    readings.clear();
+    uint64_t time = 0;
+    uint8_t fixed[3];
+    while (fread(fixed, 1, 3, in) == 3) {
+
+        uint64_t delta = 0;
+        int shift = 0;
+        int byte;
+        do {
+            byte = fgetc(in);
+            if (byte == EOF) {
+                break;
+            }
+            delta |= (uint64_t) (byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (byte == EOF || fixed[0] >= TRACE_NUM_CHANNELS) {
+            std::cerr << "Warning: Sensor trace \"" << filename
+                    << "\" is truncated or corrupt." << std::endl;
+            break;
+        }
+
+        time += delta;
+        Reading reading;
+        reading.time = time;
+        reading.channel = fixed[0];
+        reading.value = fixed[1] | (fixed[2] << 8);
+        readings.push_back(reading);
+    }
+    fclose(in);
+}
+
+/*
+ * Starts replaying the loaded readings. If realtime is true, each
+ * reading becomes visible at its original point in time (relative to
+ * now); otherwise, each call to next() returns the subsequent reading
+ * of the channel, as fast as it is queried.
+ */
+void SensorTrace::start_replaying(bool realtime) {
+
+    this->realtime = realtime;
+    for (int i = 0; i < TRACE_NUM_CHANNELS; i++) {
+        cursors[i] = 0;
+    }
+    startTime = std::chrono::steady_clock::now();
+}
+
+/*
+ * Writes the current reading of the given channel into value
+ * and returns true, or returns false if no such reading exists
+ * (yet or anymore).
+ */
+bool SensorTrace::next(int channel, uint16_t* value) {
+
+    int& cursor = cursors[channel];
+
+    if (!realtime) {
+        while (cursor < readings.size() && readings[cursor].channel != channel) {
+            cursor++;
+        }
+        if (cursor == readings.size()) {
+            return false;
+        }
+        *value = readings[cursor++].value;
+        return true;
+    }
+
+    // Find the latest reading which has already happened
+    uint64_t time = elapsed_micros();
+    int latest = -1;
+    for (int i = cursor; i < readings.size() && readings[i].time <= time; i++) {
+        if (readings[i].channel == channel) {
+            latest = i;
+        }
+    }
+    if (latest < 0) {
+        return false;
+    }
+    cursor = latest;
+    *value = readings[latest].value;
+    return true;
+}
+
+/*
+ * Returns true if all readings have been replayed.
+ */
+bool SensorTrace::is_finished() {
+
+    if (realtime) {
+        return readings.empty() || elapsed_micros() > readings.back().time;
+    }
+    for (int i = 0; i < TRACE_NUM_CHANNELS; i++) {
+        int cursor = cursors[i];
+        while (cursor < readings.size() && readings[cursor].channel != i) {
+            cursor++;
+        }
+        if (cursor < readings.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<SensorTrace::Reading>& SensorTrace::get_readings() {
+    return readings;
+}
+
+uint64_t SensorTrace::elapsed_micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,57 @@
+#ifndef THEREMIN_SENSOR_TRACE_H
+#define THEREMIN_SENSOR_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#define TRACE_CHANNEL_FREQUENCY 0
+#define TRACE_CHANNEL_VOLUME 1
+#define TRACE_NUM_CHANNELS 2
+
+/*
+ * A recording of raw, timestamped sensor readings.
+ *
+ * File format: the magic bytes "THST", a format version byte, and then
+ * one record per reading consisting of the channel (1 byte), the raw
+ * value (2 bytes, little endian) and the time since the previous
+ * reading in microseconds (unsigned LEB128 varint).
+ */
+class SensorTrace {
+
+public:
+    struct Reading {
+        uint64_t time; // microseconds since the beginning of the trace
+        uint8_t channel;
+        uint16_t value;
+    };
+
+    void start_recording(std::string filename);
+    void record(int channel, uint16_t value);
+    void stop_recording();
+
+    void load(std::string filename);
+    void start_replaying(bool realtime);
+    bool next(int channel, uint16_t* value);
+    bool is_finished();
+
+    const std::vector<Reading>& get_readings();
+
+private:
+    uint64_t elapsed_micros();
+
+    std::chrono::steady_clock::time_point startTime;
+
+    // Recording
+    FILE* file = NULL;
+    uint64_t lastRecordTime;
+
+    // Replaying
+    std::vector<Reading> readings;
+    bool realtime;
+    int cursors[TRACE_NUM_CHANNELS];
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include "stdin_input.hpp"
+
+void StdinInput::setup(Configuration* cfg) {
+    lineLength = 0;
+    finished = false;
+}
+
+/*
+ * Reads all available input and reports the values
+ * of the last complete line.
+ */
+bool StdinInput::read(InputValues* values) {
+
+    char chunk[256];
+    int size = ::read(STDIN_FILENO, chunk, sizeof(chunk));
+    if (size <= 0) {
+        finished = true;
+        return false;
+    }
+
+    bool found = false;
+    for (int i = 0; i < size; i++) {
+
+        if (chunk[i] != '\n') {
+            // Overlong lines are cut off and thus ignored
+            if (lineLength < sizeof(line) - 1) {
+                line[lineLength++] = chunk[i];
+            }
+            continue;
+        }
+
+        line[lineLength] = '\0';
+        double frequency, volume;
+        if (sscanf(line, "%lf %lf", &frequency, &volume) == 2) {
+            values->frequency = frequency;
+            values->volume = volume;
+            values->hasFrequency = true;
+            values->hasVolume = true;
+            found = true;
+        }
+        lineLength = 0;
+    }
+    return found;
+}
+
+int StdinInput::get_fd() {
+    return finished ? -1 : STDIN_FILENO;
+}
+
+bool StdinInput::is_finished() {
+    return finished;
+}
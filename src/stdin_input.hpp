@@ -0,0 +1,25 @@
+#ifndef THEREMIN_STDIN_INPUT_H
+#define THEREMIN_STDIN_INPUT_H
+
+#include "input_device.hpp"
+
+/*
+ * Reads lines of the form "<frequency> <volume>" from standard input,
+ * both values normalized to [0,1] (e.g. piped from another program).
+ * Malformed lines are ignored.
+ */
+class StdinInput : public InputDevice {
+
+public:
+    void setup(Configuration* cfg);
+    bool read(InputValues* values);
+    int get_fd();
+    bool is_finished();
+
+private:
+    char line[256];
+    int lineLength = 0;
+    bool finished = false;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <algorithm>
+#include <complex>
+#include <cmath>
+#include <map>
+
+#include "const.h"
+#include "timbre.hpp"
+
+#define SINE_TABLE_SIZE 4096
+
+static std::map<std::string, Timbre*> presets;
+static float sineTable[SINE_TABLE_SIZE + 1];
+
+/*
+ * Builds all timbre presets of the configuration, once.
+ */
+void Timbre::load_presets(Configuration* cfg) {
+
+    if (!presets.empty()) {
+        return;
+    }
+    for (int i = 0; i <= SINE_TABLE_SIZE; i++) {
+        sineTable[i] = std::sin(2 * M_PI * i / SINE_TABLE_SIZE);
+    }
+    for (int i = 0; i < cfg->num_entries(TIMBRES); i++) {
+        Configuration* timbreCfg = cfg->entry(TIMBRES, i);
+        Timbre* timbre = new Timbre();
+        timbre->setup(timbreCfg);
+        presets[timbre->name] = timbre;
+        delete timbreCfg;
+    }
+}
+
+/*
+ * Returns the preset with the given name. Exits the program
+ * with an error message if there is no such preset.
+ */
+const Timbre* Timbre::get(std::string name) {
+
+    auto it = presets.find(name);
+    if (it == presets.end()) {
+        std::cerr << "Error: Unknown timbre \"" << name << "\"." << std::endl;
+        exit(1);
+    }
+    return it->second;
+}
+
+void Timbre::setup(Configuration* cfg) {
+
+    name = cfg->str(TIMBRE_NAME);
+    std::vector<double> partialRatios = cfg->d_list(TIMBRE_RATIOS);
+    std::vector<double> partialAmplitudes = cfg->d_list(TIMBRE_AMPLITUDES);
+    std::vector<double> partialPhases(partialRatios.size(), 0.0);
+    if (cfg->has(TIMBRE_PHASES)) {
+        partialPhases = cfg->d_list(TIMBRE_PHASES);
+    }
+    if (partialAmplitudes.size() != partialRatios.size()
+            || partialPhases.size() != partialRatios.size()) {
+        std::cerr << "Error: Timbre \"" << name << "\" needs as many amplitudes "
+                << "and phases as ratios." << std::endl;
+        exit(1);
+    }
+
+    // Harmonics as complex amplitudes of sines with the given phase
+    std::vector<std::complex<double> > spectrum(Wavetable::SIZE / 2);
+    std::vector<int> order;
+    double headroom = 0;
+    for (int i = 0; i < partialRatios.size(); i++) {
+        double ratio = partialRatios[i];
+        int harmonic = (int) std::round(ratio);
+        if (ratio <= 0) {
+            std::cerr << "Error: Timbre \"" << name << "\" has a ratio "
+                    << "which is not positive." << std::endl;
+            exit(1);
+        } else if (std::abs(ratio - harmonic) < 1e-6 && harmonic < spectrum.size()) {
+            spectrum[harmonic] += std::polar(partialAmplitudes[i],
+                                             2 * M_PI * partialPhases[i] - M_PI / 2);
+        } else {
+            order.push_back(i);
+            headroom += std::abs(partialAmplitudes[i]);
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return partialRatios[a] < partialRatios[b];
+    });
+    for (int i = 0; i < order.size(); i++) {
+        ratios.push_back(partialRatios[order[i]]);
+        amplitudes.push_back(partialAmplitudes[order[i]]);
+        startPhases.push_back(partialPhases[order[i]] - std::floor(partialPhases[order[i]]));
+    }
+
+    harmonics = Wavetable::from_harmonics(spectrum, headroom);
+    gain = 0.5 / harmonics->get_normalization();
+}
+
+/*
+ * Sets the phases of the inharmonic partials to their start.
+ */
+void Timbre::reset_phases(std::vector<double>& phases) const {
+    phases = startPhases;
+}
+
+/*
+ * Advances the phases of the inharmonic partials by one sample
+ * of a wave with the given period (in samples).
+ */
+void Timbre::advance(std::vector<double>& phases, double period) const {
+
+    for (int i = 0; i < phases.size(); i++) {
+        phases[i] += ratios[i] / period;
+        phases[i] -= std::floor(phases[i]);
+    }
+}
+
+/*
+ * The value within [0,1] at the phase within [0,1) of the fundamental,
+ * for a wave with the given period in samples and the given phases
+ * of the inharmonic partials.
+ */
+double Timbre::value(double phase, double period,
+                     const std::vector<double>& phases) const {
+
+    double sum = 0;
+    for (int i = 0; i < ratios.size() && 2 * ratios[i] < period; i++) {
+        double x = phases[i] * SINE_TABLE_SIZE;
+        int idx = std::min((int) x, SINE_TABLE_SIZE - 1);
+        sum += amplitudes[i] * (sineTable[idx] + (x - idx) * (sineTable[idx+1] - sineTable[idx]));
+    }
+    return harmonics->value(phase, period) + gain * sum;
+}
@@ -0,0 +1,43 @@
+#ifndef THEREMIN_TIMBRE_H
+#define THEREMIN_TIMBRE_H
+
+#include <string>
+#include <vector>
+
+#include "configuration.hpp"
+#include "wavetable.hpp"
+
+/*
+ * A sum of partials, each given by its frequency ratio to the
+ * fundamental, its amplitude and its phase, as configured by one of the
+ * timbre presets. The harmonic partials (integer ratios) are precomputed
+ * into a band-limited Wavetable, such that their number does not affect
+ * the cost per sample. Inharmonic partials do not fit into a single cycle:
+ * each one is read from a sine table at a phase which the caller keeps
+ * and advances per sample, and left out above the Nyquist frequency.
+ */
+class Timbre {
+
+public:
+    static void load_presets(Configuration* cfg);
+    static const Timbre* get(std::string name);
+
+    void reset_phases(std::vector<double>& phases) const;
+    void advance(std::vector<double>& phases, double period) const;
+    double value(double phase, double period, const std::vector<double>& phases) const;
+
+private:
+    void setup(Configuration* cfg);
+
+    std::string name;
+    Wavetable* harmonics;
+
+    // Inharmonic partials, by ascending ratio, and their
+    // gain matching the normalization of the harmonics
+    std::vector<double> ratios;
+    std::vector<double> amplitudes;
+    std::vector<double> startPhases;
+    double gain;
+};
+
+#endif
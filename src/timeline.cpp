@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <signal.h>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "const.h"
+#include "timeline.hpp"
+
+// How often the thread of the timeline checks for a dump request
+#define TIMELINE_POLL_MS 100
+
+bool Timeline::enabled = false;
+int Timeline::size = 0;
+std::string Timeline::path;
+int64_t Timeline::origin = 0;
+
+Timeline::Ring* Timeline::rings[MAX_THREADS];
+std::atomic<int> Timeline::numRings{0};
+thread_local Timeline::Ring* Timeline::threadRing = NULL;
+
+std::thread Timeline::thread;
+std::atomic<bool> Timeline::running{false};
+std::atomic<bool> Timeline::dumpRequested{false};
+
+static std::mutex registerMutex;
+
+static void handle_signal(int signal) {
+    Timeline::request_dump();
+}
+
+Timeline::Scope::Scope(const char* name) {
+    this->name = name;
+    start = (threadRing != NULL) ? now_nanos() : 0;
+}
+
+Timeline::Scope::~Scope() {
+    if (threadRing != NULL) {
+        record(name, start, now_nanos());
+    }
+}
+
+/*
+ * Enables the timeline if configured, such that threads registering
+ * from now on record their events, and starts the thread which
+ * writes the timeline on request.
+ */
+void Timeline::setup(Configuration* cfg) {
+
+    enabled = cfg->b(TIMELINE_ENABLED);
+    if (!enabled) {
+        return;
+    }
+    size = std::max(1, cfg->i(TIMELINE_EVENTS));
+    path = cfg->str(TIMELINE_FILE);
+    origin = now_nanos();
+
+    struct sigaction action;
+    action.sa_handler = handle_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+
+    running = true;
+    thread = std::thread(&Timeline::run);
+}
+
+/*
+ * Allocates the ring of the calling thread, which appears under the
+ * given name in the timeline. To be called by each thread to be
+ * traced, before it starts its actual work.
+ */
+void Timeline::register_thread(std::string threadName) {
+
+    std::lock_guard<std::mutex> lock(registerMutex);
+    int idx = numRings.load(std::memory_order_relaxed);
+    if (!enabled || threadRing != NULL || idx == MAX_THREADS) {
+        return;
+    }
+    Ring* ring = new Ring();
+    ring->threadName = threadName;
+    ring->events = new Event[size];
+    rings[idx] = ring;
+    numRings.store(idx + 1, std::memory_order_release);
+    threadRing = ring;
+}
+
+/*
+ * Records an event of the calling thread from the given start to
+ * the given end (as returned by now_nanos()). Does nothing if the
+ * thread is not registered.
+ */
+void Timeline::record(const char* name, int64_t startNanos, int64_t endNanos) {
+
+    Ring* ring = threadRing;
+    if (ring == NULL) {
+        return;
+    }
+    uint64_t idx = ring->written.load(std::memory_order_relaxed);
+    Event& event = ring->events[idx % size];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(startNanos, std::memory_order_relaxed);
+    event.end.store(endNanos, std::memory_order_relaxed);
+    ring->written.store(idx + 1, std::memory_order_release);
+}
+
+int64_t Timeline::now_nanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Asks for the timeline to be written as soon as possible.
+ * Safe to call from a signal handler and from the audio path.
+ */
+void Timeline::request_dump() {
+    dumpRequested.store(true, std::memory_order_relaxed);
+}
+
+/*
+ * Stops the thread of the timeline.
+ */
+void Timeline::finish() {
+
+    if (running) {
+        running = false;
+        thread.join();
+    }
+}
+
+void Timeline::run() {
+
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(TIMELINE_POLL_MS));
+        if (dumpRequested.exchange(false, std::memory_order_relaxed)) {
+            dump();
+        }
+    }
+}
+
+/*
+ * Writes the events of all rings into the timeline file. The threads
+ * keep recording meanwhile: events which may have been overwritten
+ * while they were copied are left out.
+ */
+void Timeline::dump() {
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == NULL) {
+        std::cerr << "Could not write the timeline to \"" << path
+                << "\"." << std::endl;
+        return;
+    }
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    int numEvents = 0;
+    int64_t first = INT64_MAX;
+    int64_t last = 0;
+    int threads = numRings.load(std::memory_order_acquire);
+    for (int t = 0; t < threads; t++) {
+        Ring* ring = rings[t];
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                "\"tid\": %d, \"args\": {\"name\": \"%s\"}}", (t > 0) ? ",\n" : "",
+                t, ring->threadName.c_str());
+
+        uint64_t written = ring->written.load(std::memory_order_acquire);
+        uint64_t begin = (written > size) ? written - size : 0;
+        std::vector<const char*> names;
+        std::vector<int64_t> starts;
+        std::vector<int64_t> ends;
+        for (uint64_t i = begin; i < written; i++) {
+            Event& event = ring->events[i % size];
+            names.push_back(event.name.load(std::memory_order_relaxed));
+            starts.push_back(event.start.load(std::memory_order_relaxed));
+            ends.push_back(event.end.load(std::memory_order_relaxed));
+        }
+
+        // The event being recorded right now overwrites the one with
+        // the index (written - size), as seen after the copying
+        uint64_t valid = ring->written.load(std::memory_order_acquire);
+        valid = (valid >= size) ? valid - size + 1 : 0;
+        for (uint64_t i = std::max(begin, valid); i < written; i++) {
+            int e = i - begin;
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                    "\"ts\": %.3f, \"dur\": %.3f}", names[e], t,
+                    (starts[e] - origin) / 1000.0, (ends[e] - starts[e]) / 1000.0);
+            first = std::min(first, starts[e]);
+            last = std::max(last, ends[e]);
+            numEvents++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    std::cout << "Wrote a timeline of " << numEvents << " events";
+    if (numEvents > 0) {
+        std::cout << " (the last " << (last - first) / 1e9 << " s)";
+    }
+    std::cout << " to \"" << path << "\"." << std::endl;
+}
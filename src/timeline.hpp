@@ -0,0 +1,77 @@
+#ifndef THEREMIN_TIMELINE_H
+#define THEREMIN_TIMELINE_H
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <thread>
+
+#include "configuration.hpp"
+
+/*
+ * Timeline of what each thread has been doing lately, for finding out
+ * which phase took too long before a dropout. Each thread registers
+ * once and then records the phases it goes through, either by placing
+ * a Scope on the stack or by recording a span it measured itself, into
+ * a ring of its own: the most recent events of each thread are kept,
+ * at the cost of two clock readings and a few relaxed atomic stores
+ * per event. On request (SIGUSR1 or action_dump_timeline), a thread of
+ * the timeline writes the events of all rings as Chrome trace events
+ * (JSON), to be viewed e.g. with chrome://tracing or Perfetto.
+ * Without timeline_enabled, nothing is recorded.
+ */
+class Timeline {
+
+public:
+    class Scope {
+    public:
+        Scope(const char* name);
+        ~Scope();
+    private:
+        const char* name;
+        int64_t start;
+    };
+
+    static void setup(Configuration* cfg);
+    static void register_thread(std::string threadName);
+    static void record(const char* name, int64_t startNanos, int64_t endNanos);
+    static int64_t now_nanos();
+
+    static void request_dump();
+    static void finish();
+
+private:
+    struct Event {
+        std::atomic<const char*> name;
+        std::atomic<int64_t> start;
+        std::atomic<int64_t> end;
+    };
+
+    struct Ring {
+        std::string threadName;
+        Event* events;
+        // Number of events ever recorded; the event with index i
+        // is stored at events[i % size]
+        std::atomic<uint64_t> written{0};
+    };
+
+    static const int MAX_THREADS = 32;
+
+    static void run();
+    static void dump();
+
+    static bool enabled;
+    static int size;
+    static std::string path;
+    static int64_t origin;
+
+    static Ring* rings[MAX_THREADS];
+    static std::atomic<int> numRings;
+    static thread_local Ring* threadRing;
+
+    static std::thread thread;
+    static std::atomic<bool> running;
+    static std::atomic<bool> dumpRequested;
+};
+
+#endif
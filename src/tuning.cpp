@@ -0,0 +1,276 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "tuning.hpp"
+
+// MIDI key of the first note of NOTE_NAMES ("c0", i.e. C3), by which
+// Scala keyboard mappings refer to the notes
+#define FIRST_NOTE_KEY 48
+
+// Tables of the Scala tunings loaded so far, such that the tones
+// of chords can set up their tuning without reading the files again
+static std::map<std::string, NoteTable> scalaTables;
+
+/*
+ * Reads the lines of a Scala file which are not comments. Exits the
+ * program with an error message if the file cannot be opened.
+ */
+static std::vector<std::string> read_scala_lines(std::string path) {
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open the tuning file \"" << path << "\"." << std::endl;
+        exit(1);
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] != '!') {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+/*
+ * Interprets a pitch of a Scala scale, given in cents if it contains
+ * a period and as a ratio (or a whole number) otherwise.
+ * Returns 0 if it is no valid pitch.
+ */
+static double parse_scala_pitch(std::string line) {
+
+    std::stringstream stream(line);
+    std::string pitch;
+    stream >> pitch;
+    if (pitch.find('.') != std::string::npos) {
+        return std::pow(2.0, atof(pitch.c_str()) / 1200);
+    }
+    long numerator = atol(pitch.c_str());
+    long denominator = 1;
+    size_t slash = pitch.find('/');
+    if (slash != std::string::npos) {
+        denominator = atol(pitch.c_str() + slash + 1);
+    }
+    if (numerator <= 0 || denominator <= 0) {
+        return 0;
+    }
+    return (double) numerator / denominator;
+}
+
+/*
+ * Sets up the tuning configured for an instrument.
+ */
+void Tuning::setup(Configuration* cfg) {
+
+    std::string tuning = cfg->str(TUNING);
+    double reference = cfg->d(TUNING_REFERENCE);
+    if (reference <= 0) {
+        std::cerr << "Error: Invalid tuning reference " << reference << "." << std::endl;
+        exit(1);
+    }
+
+    if (tuning == TUNING_EQUAL) {
+        // The equal temperament only scales with the reference pitch
+        for (int i = 0; i < NUM_NOTES; i++) {
+            table.frequencies[i] = STANDARD_TUNING[i] * (reference / STANDARD_PITCH);
+        }
+        return;
+    }
+
+    std::string keyboard = cfg->str(TUNING_KEYBOARD);
+    std::string key = tuning + "\n" + keyboard + "\n" + std::to_string(reference);
+    auto it = scalaTables.find(key);
+    if (it == scalaTables.end()) {
+        load_scala(tuning, keyboard, reference);
+        scalaTables[key] = table;
+    } else {
+        table = it->second;
+    }
+}
+
+/*
+ * Fills the table from a Scala scale and keyboard mapping. Without a
+ * keyboard mapping, each note is the next degree of the scale, c1
+ * (middle C) is its first degree and a1 is tuned to the reference.
+ */
+void Tuning::load_scala(std::string scalePath, std::string keyboardPath, double reference) {
+
+    // Scale: a description, the number of degrees and their pitches,
+    // the last one being the interval of repetition (e.g. 2/1)
+    std::vector<std::string> lines = read_scala_lines(scalePath);
+    int numDegrees = (lines.size() >= 2) ? atoi(lines[1].c_str()) : 0;
+    if (numDegrees <= 0 || lines.size() < 2 + numDegrees) {
+        std::cerr << "Error: The tuning file \"" << scalePath
+                << "\" contains no valid scale." << std::endl;
+        exit(1);
+    }
+    std::vector<double> ratios(1, 1.0);
+    for (int i = 0; i < numDegrees; i++) {
+        double ratio = parse_scala_pitch(lines[2 + i]);
+        if (ratio <= 0) {
+            std::cerr << "Error: Invalid pitch \"" << lines[2 + i]
+                    << "\" in the tuning file \"" << scalePath << "\"." << std::endl;
+            exit(1);
+        }
+        ratios.push_back(ratio);
+    }
+    double period = ratios.back();
+
+    // Keyboard mapping: its size, the first and last key (not needed
+    // here), the key of the first degree, the reference key and its
+    // frequency, the degree of repetition and the degree of each key
+    int middleKey = FIRST_NOTE_KEY + 12;
+    int referenceKey = FIRST_NOTE_KEY + REFERENCE_NOTE_IDX;
+    int octaveDegree = numDegrees;
+    std::vector<int> mapping;
+    if (!keyboardPath.empty()) {
+        std::vector<std::string> values = read_scala_lines(keyboardPath);
+        if (values.size() < 7) {
+            std::cerr << "Error: The keyboard mapping \"" << keyboardPath
+                    << "\" is incomplete." << std::endl;
+            exit(1);
+        }
+        int mapSize = atoi(values[0].c_str());
+        middleKey = atoi(values[3].c_str());
+        referenceKey = atoi(values[4].c_str());
+        reference = atof(values[5].c_str());
+        if (atoi(values[6].c_str()) > 0) {
+            octaveDegree = atoi(values[6].c_str());
+        }
+        for (int i = 0; i < mapSize; i++) {
+            std::string value = (7 + i < values.size()) ? values[7 + i] : "x";
+            mapping.push_back(value.find('x') != std::string::npos ? -1 : atoi(value.c_str()));
+        }
+    }
+
+    // Pitch of each key relative to the first degree, or 0 for unmapped keys
+    auto ratio_of_key = [&](int key) {
+        int offset = key - middleKey;
+        int degree = offset;
+        if (!mapping.empty()) {
+            int size = mapping.size();
+            int octaves = (offset >= 0) ? offset / size : -((size - 1 - offset) / size);
+            int entry = mapping[offset - octaves * size];
+            if (entry < 0) {
+                return 0.0;
+            }
+            degree = octaves * octaveDegree + entry;
+        }
+        int periods = (degree >= 0) ? degree / numDegrees
+                : -((numDegrees - 1 - degree) / numDegrees);
+        return std::pow(period, periods) * ratios[degree - periods * numDegrees];
+    };
+
+    double referenceRatio = ratio_of_key(referenceKey);
+    if (referenceRatio == 0) {
+        std::cerr << "Error: The reference key of \"" << keyboardPath
+                << "\" is not mapped." << std::endl;
+        exit(1);
+    }
+    for (int i = 0; i < NUM_NOTES; i++) {
+        table.frequencies[i] = reference * ratio_of_key(FIRST_NOTE_KEY + i) / referenceRatio;
+    }
+
+    // Unmapped keys lie between their neighbours
+    for (int i = 0; i < NUM_NOTES; i++) {
+        if (table.frequencies[i] != 0) {
+            continue;
+        }
+        int lower = i - 1;
+        int upper = i + 1;
+        while (upper < NUM_NOTES && table.frequencies[upper] == 0) {
+            upper++;
+        }
+        if (lower < 0 || upper >= NUM_NOTES) {
+            std::cerr << "Error: The keyboard mapping \"" << keyboardPath
+                    << "\" must map the first and the last note." << std::endl;
+            exit(1);
+        }
+        table.frequencies[i] = table.frequencies[lower]
+                * std::pow(table.frequencies[upper] / table.frequencies[lower],
+                           1.0 / (upper - lower));
+    }
+
+    for (int i = 1; i < NUM_NOTES; i++) {
+        if (table.frequencies[i] <= table.frequencies[i - 1]) {
+            std::cerr << "Error: The tuning \"" << scalePath
+                    << "\" must rise from note to note." << std::endl;
+            exit(1);
+        }
+    }
+    std::cout << "Loaded tuning \"" << lines[0] << "\" (a1 = "
+            << table[REFERENCE_NOTE_IDX] << " Hz)." << std::endl;
+}
+
+double Tuning::frequency(int noteIdx) const {
+    return frequency_at(noteIdx);
+}
+
+/*
+ * The frequency at a position given in notes above c0, interpolated
+ * on the logarithmic scale between two notes. Positions outside of
+ * the table repeat its lowest or highest octave.
+ */
+double Tuning::frequency_at(double position) const {
+
+    if (position < 0) {
+        return frequency_at(position + 12) * (table[0] / table[12]);
+    } else if (position > NUM_NOTES - 1) {
+        return frequency_at(position - 12)
+                * (table[NUM_NOTES - 1] / table[NUM_NOTES - 13]);
+    }
+    int idx = std::min((int) position, NUM_NOTES - 2);
+    double share = position - idx;
+    if (share == 0) {
+        return table[idx];
+    }
+    return table[idx] * std::pow(table[idx + 1] / table[idx], share);
+}
+
+/*
+ * The position in notes above c0 of the given frequency,
+ * i.e. the inverse of frequency_at().
+ */
+double Tuning::position_of(double frequency) const {
+
+    if (frequency < table[0]) {
+        return position_of(frequency * (table[12] / table[0])) - 12;
+    } else if (frequency > table[NUM_NOTES - 1]) {
+        return position_of(frequency * (table[NUM_NOTES - 13] / table[NUM_NOTES - 1])) + 12;
+    }
+    int idx = std::min(nearest_lower_note_index(frequency), NUM_NOTES - 2);
+    return idx + std::log(frequency / table[idx]) / std::log(table[idx + 1] / table[idx]);
+}
+
+/*
+ * Finds the highest note which is lower than or equal to the
+ * given frequency (or the lowest note, if there is none).
+ */
+int Tuning::nearest_lower_note_index(double frequency) const {
+
+    const double* end = table.frequencies + NUM_NOTES;
+    int idx = std::upper_bound(table.frequencies, end, frequency) - table.frequencies;
+    return std::max(idx - 1, 0);
+}
+
+/*
+ * Finds the note which is the nearest one to
+ * the given frequency on the logarithmic scale.
+ */
+int Tuning::nearest_note_index(double frequency) const {
+
+    int lowerNoteIdx = nearest_lower_note_index(frequency);
+    if (lowerNoteIdx + 1 >= NUM_NOTES) {
+        return lowerNoteIdx;
+    }
+    // Closer to the upper note if above their geometric mean
+    if (frequency * frequency > table[lowerNoteIdx] * table[lowerNoteIdx + 1]) {
+        return lowerNoteIdx + 1;
+    }
+    return lowerNoteIdx;
+}
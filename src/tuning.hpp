@@ -0,0 +1,89 @@
+#ifndef THEREMIN_TUNING_H
+#define THEREMIN_TUNING_H
+
+#include <string>
+
+#include "const.h"
+#include "configuration.hpp"
+
+// Number of notes of a tuning table, one for each of the NOTE_NAMES
+static const int NUM_NOTES = sizeof(NOTE_NAMES) / sizeof(*NOTE_NAMES);
+// Index of the note tuned to the reference pitch ("a1", i.e. A4)
+static const int REFERENCE_NOTE_IDX = 21;
+
+/*
+ * COMPILE-TIME EQUAL TEMPERAMENT
+ * A note table for a reference pitch is generated by the compiler:
+ * each entry is the reference shifted by whole octaves and the twelfth
+ * root of a power of two, which is found by Newton's method.
+ */
+
+struct NoteTable {
+    double frequencies[NUM_NOTES];
+    constexpr double operator[](int idx) const { return frequencies[idx]; }
+};
+
+constexpr double power(double x, int n) {
+    return n == 0 ? 1 : x * power(x, n - 1);
+}
+
+constexpr double twelfth_root(double a, double x = 1.5, int iterations = 32) {
+    return iterations == 0 ? x
+            : twelfth_root(a, x - (power(x, 12) - a) / (12 * power(x, 11)), iterations - 1);
+}
+
+constexpr double equal_tempered(double reference, int noteIdx) {
+    return noteIdx < REFERENCE_NOTE_IDX ? equal_tempered(reference, noteIdx + 12) / 2
+            : noteIdx >= REFERENCE_NOTE_IDX + 12 ? equal_tempered(reference, noteIdx - 12) * 2
+            : reference * twelfth_root(power(2.0, noteIdx - REFERENCE_NOTE_IDX));
+}
+
+template <int... I> struct NoteIndices {};
+template <int N, int... I> struct MakeNoteIndices : MakeNoteIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeNoteIndices<0, I...> { typedef NoteIndices<I...> type; };
+
+template <int... I>
+constexpr NoteTable equal_temperament(double reference, NoteIndices<I...>) {
+    return NoteTable{{equal_tempered(reference, I)...}};
+}
+
+constexpr NoteTable equal_temperament(double reference) {
+    return equal_temperament(reference, MakeNoteIndices<NUM_NOTES>::type());
+}
+
+// Modern concert pitch, A4 = 440 Hz
+static constexpr double STANDARD_PITCH = 440.0;
+static constexpr NoteTable STANDARD_TUNING = equal_temperament(STANDARD_PITCH);
+
+static_assert(STANDARD_TUNING[REFERENCE_NOTE_IDX] == STANDARD_PITCH,
+              "The reference note must keep the reference pitch");
+static_assert(STANDARD_TUNING[12] > 261.62556530059 && STANDARD_TUNING[12] < 261.62556530060,
+              "c1 must be middle C");
+
+/*
+ * The frequency of each note of an instrument, in the layout of
+ * NOTE_NAMES: the equal temperament at any reference pitch, or a Scala
+ * tuning (.scl), whose degrees are assigned to the notes by a Scala
+ * keyboard mapping (.kbm). Either way, the table is filled once when
+ * the tuning is set up; pitches between two notes are interpolated
+ * on the logarithmic scale.
+ */
+class Tuning {
+
+public:
+    void setup(Configuration* cfg);
+
+    double frequency(int noteIdx) const;
+    double frequency_at(double position) const;
+    double position_of(double frequency) const;
+
+    int nearest_lower_note_index(double frequency) const;
+    int nearest_note_index(double frequency) const;
+
+private:
+    void load_scala(std::string scalePath, std::string keyboardPath, double reference);
+
+    NoteTable table = STANDARD_TUNING;
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include "const.h"
 #include "user_interface.hpp"
 #include "music_util.hpp"
+#include "metrics.hpp"
 
 /*
  * Initial input and video settings
@@ -123,6 +124,8 @@ void UserInterface::last_cursor_position(float *x, float *y) {
  */
 void UserInterface::refresh_surface() {
 
+    Metrics::displayRefreshes.add();
+
 #ifdef THEREMIN_GUI
     // Graphical window
     
@@ -206,12 +209,8 @@ void UserInterface::draw_effect_labels() {
         strOctaveUp += "All notes regular";
     }
     
-    std::string strTremolo = "[" + cfg->str(ACTION_TREMOLO) + "] ";
-    if (synth->is_tremolo_enabled()) {
-        strTremolo += "Tremolo enabled";
-    } else {
-        strTremolo += "Tremolo disabled";
-    }
+    std::string strTremolo = "[" + cfg->str(ACTION_TREMOLO) + "] Tremolo";
+    std::string strVibrato = "[" + cfg->str(ACTION_VIBRATO) + "] Vibrato";
     
     std::string strWaveform = "[" + cfg->str(ACTION_CHANGE_WAVEFORM) + "] ";
     strWaveform += "Wave: " + synth->get_waveform();
@@ -234,7 +233,8 @@ void UserInterface::draw_effect_labels() {
     // Draw the effect labels ("pedals")
     draw_pedal(strSustainNote.c_str(), 350, 15, synth->is_secondary_frequency_active());
     draw_pedal(strOctaveUp.c_str(), 350, 55, synth->is_octave_offset());
-    draw_pedal(strTremolo.c_str(), 350, 95, synth->is_tremolo_enabled());
+    draw_pedal(strTremolo.c_str(), 350, 95, 108, 30, audio->get_effects()->is_enabled(EFFECT_TREMOLO));
+    draw_pedal(strVibrato.c_str(), 462, 95, 108, 30, synth->is_vibrato_enabled());
     draw_pedal(strWaveform.c_str(), 350, 135, lastWaveform != synth->get_waveform());
     draw_pedal(strAutotune.c_str(), 350, 175, lastAutotuneMode != synth->get_autotune_mode());
     draw_pedal(strRecording.c_str(), 350, 215, audio->is_replaying() || audio->is_recording());
@@ -261,13 +261,14 @@ void UserInterface::draw_note_display() {
     round_corners(noteRect);
     
     // Calculate the currently nearest note and the according color
-    int lowerNoteIdx = MusicUtil::get_nearest_lower_note_index(synth->frequency);
+    const Tuning& tuning = synth->get_tuning();
+    int lowerNoteIdx = tuning.nearest_lower_note_index(synth->frequency);
     int noteIdx = lowerNoteIdx;
-    double lowerNoteFreqNorm = synth->get_normalized_frequency(NOTES[lowerNoteIdx]);
+    double lowerNoteFreqNorm = synth->get_normalized_frequency(tuning.frequency(lowerNoteIdx));
     float error = 0.0;
     SDL_Color noteColor = {220, 220, 255, 255};
     if (lowerNoteIdx + 1 < sizeof(NOTE_NAMES) / sizeof(*NOTE_NAMES)) {
-        double nextNoteFreqNorm = synth->get_normalized_frequency(NOTES[lowerNoteIdx + 1]);
+        double nextNoteFreqNorm = synth->get_normalized_frequency(tuning.frequency(lowerNoteIdx + 1));
         double freqDiffNorm = nextNoteFreqNorm - lowerNoteFreqNorm;
         float diffUpper = nextNoteFreqNorm - freqNormalized;
         float diffLower = freqNormalized - lowerNoteFreqNorm;
@@ -333,7 +334,7 @@ void UserInterface::draw_help_text() {
 
 void UserInterface::draw_chords() {
     
-    int noteIdx = MusicUtil::get_nearest_note_index(synth->frequency);
+    int noteIdx = synth->get_tuning().nearest_note_index(synth->frequency);
     std::string maj1 = "[" + cfg->str(ACTION_CHORD_MAJOR_1) + "] " 
             + MusicUtil::get_chord_name(noteIdx, CHORD_MODE_1, CHORD_KEY_MAJOR);
     std::string maj3 = "[" + cfg->str(ACTION_CHORD_MAJOR_3) + "] " 
@@ -502,11 +503,12 @@ void UserInterface::print_current_note() {
     init_pair(3, COLOR_RED, COLOR_BLACK);
         
     // Calculate note and its correction
-    int lower_note_idx = MusicUtil::get_nearest_lower_note_index(synth->frequency);
+    const Tuning& tuning = synth->get_tuning();
+    int lower_note_idx = tuning.nearest_lower_note_index(synth->frequency);
     MusicUtil::frequency_correction correction = MusicUtil::get_error_of_frequency(
         synth->get_normalized_frequency(synth->frequency), 
-        synth->get_normalized_frequency(NOTES[lower_note_idx]), 
-        synth->get_normalized_frequency(NOTES[lower_note_idx+1]));
+        synth->get_normalized_frequency(tuning.frequency(lower_note_idx)), 
+        synth->get_normalized_frequency(tuning.frequency(lower_note_idx+1)));
     float error = correction.rel_error;
     int note_idx;
     if (correction.lower_note_nearer) note_idx = lower_note_idx;
@@ -547,7 +549,7 @@ void UserInterface::print_current_volume() {
 
 void UserInterface::print_current_chords() {
     
-    int note_idx = MusicUtil::get_nearest_note_index(synth->frequency);
+    int note_idx = synth->get_tuning().nearest_note_index(synth->frequency);
     std::string maj1 = MusicUtil::get_chord_name(note_idx, CHORD_MODE_1, CHORD_KEY_MAJOR);
     std::string maj3 = MusicUtil::get_chord_name(note_idx, CHORD_MODE_3, CHORD_KEY_MAJOR);
     std::string maj5 = MusicUtil::get_chord_name(note_idx, CHORD_MODE_5, CHORD_KEY_MAJOR);
@@ -588,8 +590,10 @@ void UserInterface::print_buttons() {
     print_and_wrap("[" + cfg->str(ACTION_SUSTAIN_NOTE) + "] Sustain note ");
     set_highlight_text(synth->is_octave_offset());
     print_and_wrap("[" + cfg->str(ACTION_OCTAVE_UP)    + "] Add octave   ");
-    set_highlight_text(synth->is_tremolo_enabled());
+    set_highlight_text(audio->get_effects()->is_enabled(EFFECT_TREMOLO));
     print_and_wrap("[" + cfg->str(ACTION_TREMOLO)      + "] Add tremolo  ");
+    set_highlight_text(synth->is_vibrato_enabled());
+    print_and_wrap("[" + cfg->str(ACTION_VIBRATO)      + "] Add vibrato  ");
     set_highlight_text(false);
     print_linebreak();
     
@@ -1,6 +1,8 @@
 #ifndef THEREMIN_MOUSE_H
 #define THEREMIN_MOUSE_H
 
+#include <atomic>
+
 #include "const.h"
 #include "SDL2/SDL.h"
 
@@ -34,8 +36,9 @@ private:
     const char* HELP_TEXT_3 = "Press the corresponding keys";
     const char* HELP_TEXT_4 = "to trigger the effects.";
     
-    float mouse_x;
-    float mouse_y;
+    // Read concurrently by the input thread
+    std::atomic<float> mouse_x;
+    std::atomic<float> mouse_y;
     
     int window_w = 600;
     int window_h = 450;
@@ -5,8 +5,49 @@
 
 #include "wave_synth.hpp"
 #include "music_util.hpp"
+#include "wavetable.hpp"
 
-static WaveSynth::WaveLookupTable complexWaveLookup;
+// Waveforms loaded from WAV files, following the built-in ones
+static WavetableLibrary wavetables;
+#define NUM_BUILTIN_WAVEFORMS ((int) (sizeof(WAVE_NAMES)/sizeof(*WAVE_NAMES)))
+
+// Band-limited tables of the built-in waveforms played by the morph
+// waveform, indexed like WAVE_NAMES (NULL for all others)
+static std::vector<Wavetable*> builtinTables(NUM_BUILTIN_WAVEFORMS);
+
+#ifdef THEREMIN_FIXED_POINT
+// One cycle of each waveform (plus a guard entry for interpolation)
+// as unsigned Q15 values, indexed like WAVE_NAMES
+#define FIXED_TABLE_BITS 11
+#define FIXED_TABLE_SIZE (1 << FIXED_TABLE_BITS)
+static std::vector<std::vector<int16_t> > fixedWaveTables;
+#endif
+
+/*
+ * The phase of t in [0,1), shifted by the given offset.
+ */
+static double phase_of(double t, double period, double offset = 0) {
+    
+    double p = fmod(t, period) / period - offset;
+    p -= std::floor(p);
+    return p;
+}
+
+/*
+ * The index of the built-in waveform with the given name, or -1.
+ */
+static int builtin_index(std::string name) {
+    
+    for (int i = 0; i < NUM_BUILTIN_WAVEFORMS; i++) {
+        if (WAVE_NAMES[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static const int COMPLEX_IDX = builtin_index(WAVE_COMPLEX);
+static const int MORPH_IDX = builtin_index(WAVE_MORPH);
 
 void WaveSynth::init(Configuration* cfg) {
     
@@ -17,93 +58,127 @@ void WaveSynth::init(Configuration* cfg) {
     waveform = cfg->str(WAVEFORM);
     period = sample_rate / frequency;
     
-    // Find the correct index of the default waveform
-    for (int i = 0; i < sizeof(WAVE_NAMES)/sizeof(*WAVE_NAMES); i++) {
+    // Find the correct index of the default waveform,
+    // which may also be one of the wavetables
+    wavetables.start(cfg->str(WAVETABLE_DIR), cfg->i(WAVETABLE_POLL_MS));
+    int tableIdx = wavetables.find(waveform);
+    if (tableIdx >= 0) {
+        waveformIdx = NUM_BUILTIN_WAVEFORMS + tableIdx;
+    }
+    for (int i = 0; i < NUM_BUILTIN_WAVEFORMS; i++) {
         if (WAVE_NAMES[i] == waveform) {
             waveformIdx = i;
             break;
         }
     }
     
+    tuning.setup(cfg);
     std::string lowest_note = cfg->str(LOWEST_NOTE);
-    for (int i = 0; i < sizeof(NOTE_NAMES)/sizeof(*NOTE_NAMES); i++) {
+    int lowestNoteIdx = 0;
+    for (int i = 0; i < NUM_NOTES; i++) {
         if (NOTE_NAMES[i] == lowest_note) {
-            frequency = NOTES[i];
+            frequency = tuning.frequency(i);
             minFreq = frequency;
+            lowestNoteIdx = i;
             break;
         }
     }
+    
+    // Oscillators of the waveforms with jumps or corners
+    const char* oscillators[][2] = {{WAVE_SQUARE, OSCILLATOR_SQUARE},
+                                    {WAVE_SAW, OSCILLATOR_SAW},
+                                    {WAVE_TRIANGLE, OSCILLATOR_TRIANGLE},
+                                    {WAVE_PLATEAU, OSCILLATOR_PLATEAU}};
+    std::vector<bool> polyblep(NUM_BUILTIN_WAVEFORMS, false);
+    for (int o = 0; o < sizeof(oscillators)/sizeof(*oscillators); o++) {
+        std::string mode = cfg->str(oscillators[o][1]);
+        if (mode != OSCILLATOR_NAIVE && mode != OSCILLATOR_POLYBLEP) {
+            std::cout << "Error: Unknown oscillator \"" << mode << "\"." << std::endl;
+            exit(1);
+        }
+        for (int i = 0; i < polyblep.size(); i++) {
+            if (WAVE_NAMES[i] == std::string(oscillators[o][0])) {
+                polyblep[i] = (mode == OSCILLATOR_POLYBLEP);
+            }
+        }
+    }
+    waveFunctions.resize(NUM_BUILTIN_WAVEFORMS);
+    for (int i = 0; i < NUM_BUILTIN_WAVEFORMS; i++) {
+        waveFunctions[i] = get_wave_function(WAVE_NAMES[i], polyblep[i]);
+    }
+    
     numOctaves = cfg->d(NUM_OCTAVES);
     maxVol = cfg->i(MAX_VOLUME);
     maxVolumeChangePerTick = cfg->d(MAX_VOLUME_CHANGE_PER_TICK);
     
+    // Envelope of the tones of chords
+    envelope.setup(sample_rate, cfg->d(CHORD_CROSSFADE_MS), cfg->d(CHORD_DECAY_MS),
+                   cfg->d(CHORD_SUSTAIN), cfg->d(CHORD_CROSSFADE_MS));
+    
+    vibrato.setup(sample_rate, cfg->str(VIBRATO_SHAPE),
+                  Lfo::frequency(cfg, VIBRATO_FREQUENCY, VIBRATO_SYNC_BEATS));
+    vibratoDepth = cfg->d(VIBRATO_DEPTH);
+    if (cfg->b(VIBRATO_ENABLED)) {
+        vibrato.start();
+    }
+    
     autotuneMode = cfg->str(AUTOTUNE_MODE);
+    pitchQuantizer.init(cfg, tuning, lowestNoteIdx, numOctaves);
     
     waveSmoothing.waveSwitch = false;
     waveSmoothing.lastWaveAddOffset = 0.0;
     waveSmoothing.lastWaveTotalOffset = 0.0;
     waveSmoothing.wavePeriod = period;
     
-    tremolo = cfg->b(TREMOLO_ENABLED);
-    tremoloFrequency = cfg->d(TREMOLO_FREQUENCY);
-    tremoloIntensity = cfg->d(TREMOLO_INTENSITY);
-    
-    std::vector<double> frequency_ratios;
-    std::vector<double> shares;
-    
-    frequency_ratios.push_back(1.0);
-    frequency_ratios.push_back(2.0);
-    frequency_ratios.push_back(3.0);
-    frequency_ratios.push_back(4.0);
-    frequency_ratios.push_back(5.0);
-    frequency_ratios.push_back(6.0);
-    frequency_ratios.push_back(7.0);
-    frequency_ratios.push_back(8.0);
-    frequency_ratios.push_back(9.0);
-    frequency_ratios.push_back(10.0);
-    frequency_ratios.push_back(11.0);
-    frequency_ratios.push_back(12.0);
-    frequency_ratios.push_back(13.0);
-    frequency_ratios.push_back(14.0);
-    frequency_ratios.push_back(15.0);
-    frequency_ratios.push_back(16.0);
-    frequency_ratios.push_back(17.0);
-    frequency_ratios.push_back(18.0);
-    frequency_ratios.push_back(19.0);
-    frequency_ratios.push_back(20.0);
-    
-    shares.push_back(1);
-    shares.push_back(9);
-    shares.push_back(4);
-    shares.push_back(2);
-    shares.push_back(0.5);
-    shares.push_back(0.1);
-    shares.push_back(0.2);
-    shares.push_back(0.1);
-    shares.push_back(0.05);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    shares.push_back(0.01);
-    
-    // Normalize shares so that they sum up to 1
-    double sumShares = 0.0;
-    for (int i = 0; i < shares.size(); i++) {
-        sumShares += shares[i];
-    }
-    for (int i = 0; i < shares.size(); i++) {
-        shares[i] /= sumShares;
-    }
-    
-    complexWaveLookup.frequency_ratios = frequency_ratios;
-    complexWaveLookup.shares = shares;
+    // Partials of the complex waveform
+    Timbre::load_presets(cfg);
+    timbre = Timbre::get(cfg->str(TIMBRE));
+    timbre->reset_phases(partialPhases);
+    
+    // Waveforms of the morph waveform, each one read from a table
+    morphWaveforms.clear();
+    std::vector<std::string> morphNames = cfg->str_list(MORPH_WAVEFORMS);
+    for (int i = 0; i < morphNames.size(); i++) {
+        int idx = builtin_index(morphNames[i]);
+        if (idx < 0 && wavetables.find(morphNames[i]) >= 0) {
+            idx = NUM_BUILTIN_WAVEFORMS + wavetables.find(morphNames[i]);
+        }
+        if (idx < 0 || idx == MORPH_IDX) {
+            std::cerr << "Error: Cannot morph the waveform \"" 
+                    << morphNames[i] << "\"." << std::endl;
+            exit(1);
+        }
+        morphWaveforms.push_back(idx);
+    }
+    if (morphWaveforms.empty()) {
+        std::cerr << "Error: No waveforms to morph between." << std::endl;
+        exit(1);
+    }
+    build_morph_tables(morphWaveforms);
+    morphTarget = std::min(std::max(cfg->d(MORPH_POSITION), 0.0), 1.0);
+    morphPosition = morphTarget;
+    double morphSamples = cfg->d(MORPH_TIME) / 1000 * sample_rate;
+    morphStep = (morphSamples > 1) ? 1 / morphSamples : 1;
+    
+#ifdef THEREMIN_FIXED_POINT
+    if (fixedWaveTables.empty()) {
+        build_fixed_tables();
+    }
+    update_phase_increment();
+    update_gain();
+#endif
+    
+    // Voices for the tones of chords, prepared like this synthesizer
+    // such that starting a tone needs no setup on the audio path.
+    // Chord tones keep their pitch, as they are rendered without smoothing.
+    WaveSynth voice = *this;
+    voice.children.clear();
+    voice.waveSmoothing.active = false;
+    voice.vibratoDepth = 0;
+    voice.set_secondary_frequency(0.0);
+    children.assign(MAX_CHILD_VOICES, voice);
+    playingChildren.clear();
+    playingChildren.reserve(MAX_CHILD_VOICES);
 }
 
 /*
@@ -112,6 +187,10 @@ void WaveSynth::init(Configuration* cfg) {
  */
 uint16_t WaveSynth::wave(double t) {
     
+#ifdef THEREMIN_FIXED_POINT
+    return wave_fixed(t);
+#endif
+    
     // Initial time value to pass to children tones
     double old_t = t;
     
@@ -130,18 +209,12 @@ uint16_t WaveSynth::wave(double t) {
         t2 = t + waveSmoothingSecondary.lastWaveAddOffset * period2;
     }
     
-    // Apply tremolo effect (if enabled)
-    double volumeToUse = (tremolo ? get_tremolo_volume(t) : volume);
-    
-    // Find correct wave function
-    auto function = get_wave_function();
-    
     // Calculate basic value
-    double value = function(t, period, volumeToUse);
+    double value = wave_value(t, period);
     
     // Calculate secondary value (if enabled) and adapt volume
     if (secondaryFrequency != 0.0) {
-        double value2 = function(t2, period2, volumeToUse);
+        double value2 = wave_value(t2, period2);
         value = std::round((1 - secondaryVolumeShare) * value + secondaryVolumeShare * value2);
     } else {
         value = std::round((1 - secondaryVolumeShare) * value);
@@ -150,68 +223,161 @@ uint16_t WaveSynth::wave(double t) {
     // Adapt volume for chords 
     // and call the additional tones' wave function to accumulate the sound
     value /= 3;
-    double childVals1 = 0;
-    double childVals2 = 0;
-    if (children.size() > 0) {
-        for (int i = 0; i < children.size(); i++) {
-            childVals1 += children[i].wave(old_t);
-        }
+    for (int i = 0; i < playingChildren.size(); i++) {
+        WaveSynth& child = children[playingChildren[i]];
+        value += child.envelope.value() * child.wave(old_t);
     }
-    if (fading && nextChildren.size() > 0) {
-        for (int i = 0; i < nextChildren.size(); i++) {
-            childVals2 += nextChildren[i].wave(old_t);
-        }
-    }
-    value += fadingOutFactor * childVals1 + fadingInFactor * childVals2;
     
     return (uint16_t) value;
 }
 
+/*
+ * The value of the current waveform within [0, volume] at t for a wave
+ * of the given period, mixed with the previous waveform while it is
+ * fading out after a switch.
+ */
+double WaveSynth::wave_value(double t, double period) {
+    
+    double value = waveform_value(waveformIdx, t, period);
+    if (crossfade < 1) {
+        value = crossfade * value 
+                + (1 - crossfade) * waveform_value(previousWaveformIdx, t, period);
+    }
+    return value;
+}
+
+/*
+ * The value of the waveform with the given index within [0, volume]:
+ * read from tables for the wavetables, the complex waveform (whose
+ * inharmonic partials always follow the primary wave) and the morph
+ * waveform, or evaluated by the wave function.
+ */
+double WaveSynth::waveform_value(int idx, double t, double period) {
+    
+    if (idx == MORPH_IDX) {
+        return volume * morph_value(phase_of(t, period), period);
+    } else if (idx == COMPLEX_IDX || idx >= NUM_BUILTIN_WAVEFORMS) {
+        return volume * table_value(idx, phase_of(t, period), period);
+    }
+    return waveFunctions[idx](t, period, volume);
+}
+
+/*
+ * The value within [0,1] of the morph waveform at the given phase:
+ * the mix of the two waveforms around the morph position.
+ */
+double WaveSynth::morph_value(double phase, double period) {
+    
+    int last = morphWaveforms.size() - 1;
+    double x = morphPosition * last;
+    int idx = std::min((int) x, last);
+    double share = x - idx;
+    double value = table_value(morphWaveforms[idx], phase, period);
+    if (share > 0) {
+        value += share * (table_value(morphWaveforms[idx + 1], phase, period) - value);
+    }
+    return value;
+}
+
+/*
+ * The value within [0,1] of the waveform with the given index read
+ * from its table: the current version of a wavetable, the timbre,
+ * or the table built for morphing a built-in waveform.
+ */
+double WaveSynth::table_value(int idx, double phase, double period) {
+    
+    if (idx >= NUM_BUILTIN_WAVEFORMS) {
+        return wavetables.get(idx - NUM_BUILTIN_WAVEFORMS)->value(phase, period);
+    } else if (idx == COMPLEX_IDX) {
+        return timbre->value(phase, period, partialPhases);
+    }
+    return builtinTables[idx]->value(phase, period);
+}
+
+/*
+ * Starts a tone of the chord on a free voice of the pool, or on the
+ * quietest voice fading out if all of them are in use.
+ */
 void WaveSynth::add_child_note(int rel_halftones) {
     
-    int noteIdx = MusicUtil::get_nearest_note_index(frequency);
-    double note = NOTES[noteIdx] * std::pow(root12Of2, rel_halftones);
+    int noteIdx = tuning.nearest_note_index(frequency);
+    double note = tuning.frequency(noteIdx + rel_halftones);
+    
+    int idx = -1;
+    for (int i = 0; i < children.size(); i++) {
+        Envelope& envelope = children[i].envelope;
+        if (envelope.is_idle()) {
+            idx = i;
+            playingChildren.push_back(idx);
+            break;
+        }
+        if (envelope.is_releasing() && (idx < 0
+                || envelope.value() < children[idx].envelope.value())) {
+            idx = i;
+        }
+    }
+    if (idx < 0) {
+        return;
+    }
+    WaveSynth* child = &children[idx];
     
-    WaveSynth child_synth;
-    child_synth.init(cfg);
-    child_synth.frequency = note;
-    child_synth.period = sample_rate / child_synth.frequency;
-    child_synth.waveSmoothing.active = false;
-    child_synth.update_volume(volumeTarget);
-    child_synth.set_secondary_frequency(0.0);
-    child_synth.waveformIdx = waveformIdx;
-    child_synth.waveform = waveform;
-    nextChildren.push_back(child_synth);
+    child->frequency = note;
+    child->period = sample_rate / note;
+    child->volume = maxVol;
+    child->update_volume(volumeTarget);
+    child->waveformIdx = waveformIdx;
+    child->crossfade = 1;
+    child->morphPosition = morphPosition;
+    child->morphTarget = morphTarget;
+    timbre->reset_phases(child->partialPhases);
+#ifdef THEREMIN_FIXED_POINT
+    child->phase = 0;
+    child->update_phase_increment();
+    child->update_gain();
+#endif
+    child->envelope.note_on();
 }
 
+/*
+ * Releases the current chord, if any, and crossfades it
+ * into the given chord relative to the current frequency.
+ */
 void WaveSynth::set_chord_notes(int chordMode, int chordKey) {
    
-    nextChildren.clear();
+    release_child_notes();
     
     std::vector<int> intervals = MusicUtil::get_chord_intervals(chordMode, chordKey);
     for (int i = 0; i < intervals.size(); i++) {
         add_child_note(intervals[i]);
     }
     
-    fadingOutFactor = 1;
-    fadingInFactor = 0;
-    fading = true;
-    
-    int chordNoteIdx = MusicUtil::get_nearest_note_index(frequency);
+    int chordNoteIdx = tuning.nearest_note_index(frequency);
     currentChordName = MusicUtil::get_chord_name(
                 chordNoteIdx, chordMode, chordKey);
 }
 
 void WaveSynth::clear_child_notes() {
-    nextChildren.clear();
-    fadingOutFactor = 1;
-    fadingInFactor = 0;
-    fading = true;
+    release_child_notes();
     currentChordName = "";
 }
 
 bool WaveSynth::has_child_notes() {
-    return children.size() > 0;
+    for (int i = 0; i < children.size(); i++) {
+        if (!children[i].envelope.is_releasing()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Lets all child tones fade out. Their voices are free
+ * again once they are silent.
+ */
+void WaveSynth::release_child_notes() {
+    for (int i = 0; i < children.size(); i++) {
+        children[i].envelope.note_off();
+    }
 }
 
 /*
@@ -234,6 +400,10 @@ void WaveSynth::set_secondary_frequency(double frequency) {
     waveSmoothingSecondary.lastWaveAddOffset = 0;
     waveSmoothingSecondary.lastWaveTotalOffset = 0;
     waveSmoothingSecondary.waveSwitch = false;
+#ifdef THEREMIN_FIXED_POINT
+    secondaryPhase = phase;
+    secondaryPhaseIncrement = phaseIncrement;
+#endif
 }
 
 bool WaveSynth::is_secondary_frequency_active() {
@@ -252,96 +422,121 @@ void WaveSynth::set_octave_offset(bool offset) {
 }
 
 /*
- * Starts or stops the tremolo effect.
- * Stopping does not take plase immediately but at the next 
- * appropriate sample such that there will be no cracking.
+ * Switches to the next waveform: the definitions inside const.h,
+ * followed by the wavetables loaded so far.
  */
-void WaveSynth::set_tremolo(bool shouldTremolo) {
+void WaveSynth::switch_waveform() {
     
-    if (shouldTremolo) {
-        tremolo = true;
-        tremoloOffset = 0.0;
-        tremoloExiting = false;
+    previousWaveformIdx = waveformIdx;
+    waveformIdx = (waveformIdx + 1) % get_num_waveforms();
+    if (waveformIdx < NUM_BUILTIN_WAVEFORMS) {
+        waveform = WAVE_NAMES[waveformIdx];
     } else {
-        tremoloExiting = true;
+        waveform = wavetables.get_name(waveformIdx - NUM_BUILTIN_WAVEFORMS);
     }
-}
-
-/*
- * Switches to the next waveform, according to the definitions
- * inside config.h.
- */
-void WaveSynth::switch_waveform() {
     
-    waveformIdx = (waveformIdx + 1) % (sizeof(WAVE_NAMES)/sizeof(*WAVE_NAMES));
-    waveform = WAVE_NAMES[waveformIdx];
-    
-    // a change of the wave offset is unneccessary
-    // as the wave transition will not be continous anyway
+    // The previous waveform fades out over the morph time, such that the
+    // transition is continuous without changing the wave offset
+    crossfade = 0;
 }
 
 /*
- * Pitches the current frequency in a soft manner, i.e.
- * a frequency tends to approach the next proper halfnote
- * (but all frequencies inbetween are possible as well).
+ * Applies a single action triggered by a key press, given by the key
+ * bound to it. Keys of actions which do not concern the synthesizer
+ * itself are ignored.
  */
-void WaveSynth::align_frequency() {
-    
-    if (frequency <= 0 || autotuneMode == AUTOTUNE_NONE) {
-        return;
-    }
+void WaveSynth::apply_action(std::string action) {
     
-    double freqNew;
-    
-    if (autotuneMode == AUTOTUNE_SMOOTH) {
-            
-        double freqInLog = std::log(frequency) * M_LOG2E;
-        if (freqInLog <= 0) {
-            return;
+    if (action == cfg->str(ACTION_SUSTAIN_NOTE)) {
+        if (!is_secondary_frequency_active()) {
+            set_secondary_frequency(frequency);
+        } else {
+            set_secondary_frequency(0.0);
         }
-        double toneQualitySine = std::sin(
-                    (freqInLog - std::log(freqA) * M_LOG2E) 
-                    * 2 * M_PI / ratioInLog
-                );
-        freqNew = frequency - (1 / (ratioInLog * (2 * M_PI))) 
-            * toneQualitySine;
-            
-    } else /*if (autotuneMode == AUTOTUNE_FULL)*/ {
         
-        freqNew = NOTES[MusicUtil::get_nearest_note_index(frequency)];
+    } else if (action == cfg->str(ACTION_OCTAVE_UP)) {
+        set_octave_offset(!is_octave_offset());
+        
+    } else if (action == cfg->str(ACTION_VIBRATO)) {
+        set_vibrato(!is_vibrato_enabled());
+        
+    } else if (action == cfg->str(ACTION_CHANGE_WAVEFORM)) {
+        switch_waveform();
+        
+    } else if (action == cfg->str(ACTION_AUTOTUNE_NONE)) {
+        set_autotune_mode(AUTOTUNE_NONE);
+        
+    } else if (action == cfg->str(ACTION_AUTOTUNE_SMOOTH)) {
+        set_autotune_mode(AUTOTUNE_SMOOTH);
+        
+    } else if (action == cfg->str(ACTION_AUTOTUNE_FULL)) {
+        set_autotune_mode(AUTOTUNE_FULL);
+        
+    } else if (action == cfg->str(ACTION_CHORD_MAJOR_1)) {
+        set_chord_notes(CHORD_MODE_1, CHORD_KEY_MAJOR);
+    } else if (action == cfg->str(ACTION_CHORD_MAJOR_3)) {
+        set_chord_notes(CHORD_MODE_3, CHORD_KEY_MAJOR);
+    } else if (action == cfg->str(ACTION_CHORD_MAJOR_5)) {
+        set_chord_notes(CHORD_MODE_5, CHORD_KEY_MAJOR);
+    } else if (action == cfg->str(ACTION_CHORD_MINOR_1)) {
+        set_chord_notes(CHORD_MODE_1, CHORD_KEY_MINOR);
+    } else if (action == cfg->str(ACTION_CHORD_MINOR_3)) {
+        set_chord_notes(CHORD_MODE_3, CHORD_KEY_MINOR);
+    } else if (action == cfg->str(ACTION_CHORD_MINOR_5)) {
+        set_chord_notes(CHORD_MODE_5, CHORD_KEY_MINOR);
+    } else if (action == cfg->str(ACTION_CHORD_CLEAR)) {
+        clear_child_notes();
     }
-    
-    frequency = freqNew;
 }
 
 /*
- * Gets a value [0,1] and maps it to a frequency.
+ * Gets a value [0,1] and maps it to a frequency, corrected
+ * according to the current autotune mode and scale.
+ * A value of -1 re-evaluates the last value (e.g. after the
+ * octave offset has changed).
  */
 void WaveSynth::update_frequency(float value) {
     
     double oldFrequency = frequency;
 
-    if (value != -1) {
-        if (octaveOffset) {
-            value += 1.0 / numOctaves;
-        }
-        
-        frequency = minFreq * std::pow(2, numOctaves * value);
+    if (value == -1) {
+        value = lastFrequencyValue;
+    } else {
+        lastFrequencyValue = value;
     }
+    if (octaveOffset) {
+        value += 1.0 / numOctaves;
+    }
+    frequency = pitchQuantizer.frequency_at(numOctaves * value);
     
-    if (value == -1 || oldFrequency != frequency) {
-        align_frequency();
+    if (oldFrequency != frequency) {
         waveSmoothing.waveSwitch = true;
         waveSmoothingSecondary.waveSwitch = true;
     }
-    period = sample_rate / frequency;
-    waveSmoothing.wavePeriod = period;
+    update_period();
     
     if (cfg->b(LOG_FREQ)) {
         std::cout << frequency << std::endl;
     }
 }
 
+/*
+ * Derives the period of the wave from the frequency
+ * and the current detuning by the vibrato.
+ */
+void WaveSynth::update_period() {
+    
+    double oldPeriod = period;
+    period = sample_rate / (frequency * detune);
+    if (oldPeriod != period) {
+        waveSmoothing.waveSwitch = true;
+    }
+    waveSmoothing.wavePeriod = period;
+#ifdef THEREMIN_FIXED_POINT
+    update_phase_increment();
+#endif
+}
+
 /*
  * Gets a value [0,1] and maps it to a volume.
  *
@@ -357,15 +552,13 @@ void WaveSynth::update_volume(float value) {
     for (int i = 0; i < children.size(); i++) {
         children[i].update_volume(value);
     }
-    for (int i = 0; i < nextChildren.size(); i++) {
-        nextChildren[i].update_volume(value);
-    }
 }
 
 /*
  * Lets the volume approach the current target volume
  * by a maximal difference of MAX_VOLUME_CHANGE_PER_TICK.
- * Also advances and finalizes crossfading of chords, if currently active.
+ * Also advances the vibrato, the morphing, the inharmonic partials
+ * and the envelopes of the child tones which are playing.
  */
 void WaveSynth::volume_tick() {
     
@@ -378,25 +571,39 @@ void WaveSynth::volume_tick() {
     }
     volume += volumeDiff;
     
-    // Adjust volume of children tones
-    for (int i = 0; i < children.size(); i++) {
-        children[i].volume_tick();
+    // Detune by the vibrato, once per control block (and
+    // once more when it is over, to restore the exact pitch)
+    if (vibrato.tick() && (vibrato.is_active() || detune != 1)) {
+        detune = std::pow(root12Of2, vibratoDepth * vibrato.value());
+        update_period();
+    }
+    timbre->advance(partialPhases, period);
+    
+    // Glide towards the target of the morph position,
+    // and fade out the previous waveform after a switch
+    if (morphPosition < morphTarget) {
+        morphPosition = std::min(morphPosition + morphStep, morphTarget);
+    } else if (morphPosition > morphTarget) {
+        morphPosition = std::max(morphPosition - morphStep, morphTarget);
     }
-    for (int i = 0; i < nextChildren.size(); i++) {
-        nextChildren[i].volume_tick();
+    if (crossfade < 1) {
+        crossfade = std::min(crossfade + morphStep, 1.0);
     }
+#ifdef THEREMIN_FIXED_POINT
+    update_gain();
+    phase += phaseIncrement;
+    secondaryPhase += secondaryPhaseIncrement;
+#endif
     
-    // Cross-fade between current and incoming child tones
-    if (fading) {
-        fadingOutFactor -= 0.02;
-        fadingInFactor += 0.02;
-        
-        if (fadingOutFactor <= 0 && fadingInFactor >= 1) {
-            children = nextChildren;
-            nextChildren.clear();
-            fadingOutFactor = 1;
-            fadingInFactor = 1;
-            fading = false;
+    // Adjust volume and envelope of children tones
+    for (int i = 0; i < playingChildren.size(); i++) {
+        WaveSynth& child = children[playingChildren[i]];
+        child.volume_tick();
+        child.envelope.tick();
+    }
+    for (int i = playingChildren.size() - 1; i >= 0; i--) {
+        if (children[playingChildren[i]].envelope.is_idle()) {
+            playingChildren.erase(playingChildren.begin() + i);
         }
     }
 }
@@ -427,6 +634,33 @@ void WaveSynth::set_wave_offset(double t, WaveSmoothing* smoothing) {
 
 void WaveSynth::set_autotune_mode(std::string mode) {
     autotuneMode = mode;
+    pitchQuantizer.set_mode(mode);
+}
+
+/*
+ * Sets the morph position within [0,1], towards which the mix
+ * of the morph waveform glides within the morph time.
+ */
+void WaveSynth::set_morph_position(double position) {
+    
+    morphTarget = std::min(std::max(position, 0.0), 1.0);
+    
+    // Also update the position for child tones
+    for (int i = 0; i < children.size(); i++) {
+        children[i].set_morph_position(position);
+    }
+}
+
+/*
+ * Starts the vibrato at its original pitch, or lets
+ * it return there and stop.
+ */
+void WaveSynth::set_vibrato(bool enabled) {
+    if (enabled) {
+        vibrato.start();
+    } else {
+        vibrato.stop();
+    }
 }
 
 double WaveSynth::get_max_frequency() {
@@ -437,14 +671,53 @@ bool WaveSynth::is_octave_offset() {
     return octaveOffset;
 }
 
-bool WaveSynth::is_tremolo_enabled() {
-    return tremolo;
+bool WaveSynth::is_vibrato_enabled() {
+    return vibrato.is_running();
 }
 
 std::string WaveSynth::get_waveform() {
     return waveform;
 }
 
+int WaveSynth::get_num_waveforms() {
+    return NUM_BUILTIN_WAVEFORMS + wavetables.size();
+}
+
+double WaveSynth::get_morph_position() {
+    return morphPosition;
+}
+
+/*
+ * Samples one cycle of each given built-in waveform into a band-limited
+ * table, unless it has been built before. The complex waveform
+ * and wavetables come with their own tables.
+ */
+void WaveSynth::build_morph_tables(const std::vector<int>& waveformIdcs) {
+    
+    for (int i = 0; i < waveformIdcs.size(); i++) {
+        
+        int idx = waveformIdcs[i];
+        if (idx >= NUM_BUILTIN_WAVEFORMS || builtinTables[idx] != NULL) {
+            continue;
+        }
+        wavefunc function = get_wave_function(WAVE_NAMES[idx]);
+        if (function == NULL) {
+            continue;
+        }
+        
+        std::vector<float> cycle(Wavetable::SIZE);
+        for (int j = 0; j < cycle.size(); j++) {
+            double value = function(j, cycle.size(), 1.0);
+            if (!std::isfinite(value)) {
+                // e.g. the center of the single slit (0/0)
+                value = 1.0;
+            }
+            cycle[j] = 2 * value - 1;
+        }
+        builtinTables[idx] = Wavetable::from_cycle(cycle);
+    }
+}
+
 std::string WaveSynth::get_autotune_mode() {
     return autotuneMode;
 }
@@ -453,6 +726,10 @@ std::string WaveSynth::get_current_chord_name() {
     return currentChordName;
 }
 
+const Tuning& WaveSynth::get_tuning() {
+    return tuning;
+}
+
 /*
  * Maps a frequency inside the minimum and maximum frequency bounds
  * to a linear value in [0,1], such that two pairs of tones with the same
@@ -468,39 +745,13 @@ double WaveSynth::get_normalized_frequency(double f) {
 }
 
 /*
- * Determines the volume that should be used for the current tick 
- * if the tremolo effect is enabled. The actual volume is being modulated
- * by adding a sine wave. Also finalizes the effect if it is to fade out.
- */
-double WaveSynth::get_tremolo_volume(double t) {
-    
-    double volumeToUse;
-    
-    if (tremoloOffset == 0.0) {
-        tremoloOffset = t;
-    }
-    // Add a sine wave to the volume in order to modulate it
-    volumeToUse = volume + tremoloIntensity * volume 
-        * std::sin(t * 2 * M_PI / (sample_rate / tremoloFrequency)
-        - tremoloOffset * 2 * M_PI / (sample_rate / tremoloFrequency));
-    volumeToUse = std::min(volumeToUse, (double) maxVol);
-    volumeToUse = std::max(volumeToUse, 0.0);
-    
-    // If tremolo is to fade out, 
-    // check if now is an appropriate time to smoothly stop the effect
-    if (tremoloExiting && std::abs(volumeToUse - volume) <= maxVol / 1000.0) {
-        tremolo = false;
-    }
-    
-    return volumeToUse;
-}
-
-/*
- * Returns the wave function which should be used according to the object's
- * waveform attribute. Exits the program with an error message if no waveform
+ * Returns the wave function corresponding to the given waveform,
+ * if possible its antialiased variant if polyblep is set, or NULL
+ * for the complex and the morph waveform, which are played from tables.
+ * Exits the program with an error message if no waveform
  * is specified.
  */
-wavefunc WaveSynth::get_wave_function() {
+wavefunc WaveSynth::get_wave_function(std::string waveform, bool polyblep) {
     
     auto function = sin;
     
@@ -524,16 +775,146 @@ wavefunc WaveSynth::get_wave_function() {
         function = halfcirc;
     } else if (waveform == WAVE_SINGLESLIT) {
         function = singleslit;
-    } else if (waveform == WAVE_COMPLEX) {
-        function = complex;
+    } else if (waveform == WAVE_COMPLEX || waveform == WAVE_MORPH) {
+        function = NULL;
     } else {
         std::cout << "Error: No valid wavetype specified." << std::endl;
         exit(1);
     }
     
+    if (polyblep) {
+        if (function == square) {
+            function = square_polyblep;
+        } else if (function == triangle) {
+            function = triangle_polyblep;
+        } else if (function == saw) {
+            function = saw_polyblep;
+        } else if (function == plateau) {
+            function = plateau_polyblep;
+        }
+    }
+    
     return function;
 }
 
+#ifdef THEREMIN_FIXED_POINT
+
+/*
+ * Integer counterpart of wave(): reads the waveform's table at the
+ * current phase, interpolating linearly, and scales it by the gain.
+ * Transcendental functions are only evaluated when the tables are built.
+ */
+uint16_t WaveSynth::wave_fixed(double t) {
+    
+    // The phases only advance with volume_tick(), such that a declined
+    // sample is generated again in the same way
+    int32_t value = wave_fixed_value(phase + phaseIncrement, phaseIncrement);
+    
+    // Q15 * Q31 yields a value within [0, 2^16)
+    value = ((int64_t) value * gain) >> 30;
+    
+    // Mix in the secondary wave with a share of 0.1 (3277 in Q15)
+    if (secondaryFrequency != 0.0) {
+        int32_t value2 = wave_fixed_value(secondaryPhase + secondaryPhaseIncrement,
+                                          secondaryPhaseIncrement);
+        value2 = ((int64_t) value2 * gain) >> 30;
+        value = (value * 29491 + value2 * 3277) >> 15;
+    } else {
+        value = (value * 29491) >> 15;
+    }
+    
+    // Adapt volume for chords 
+    // and accumulate the additional tones
+    value /= 3;
+    for (int i = 0; i < playingChildren.size(); i++) {
+        WaveSynth& child = children[playingChildren[i]];
+        value += (int32_t) (child.envelope.value() * child.wave(t));
+    }
+    
+    return (uint16_t) value;
+}
+
+/*
+ * The value of the current waveform at the given phase as unsigned Q15,
+ * mixed with the previous waveform while it is fading out.
+ */
+int32_t WaveSynth::wave_fixed_value(uint32_t currentPhase, uint32_t increment) {
+    
+    int32_t value = waveform_fixed_value(waveformIdx, currentPhase, increment);
+    if (crossfade < 1) {
+        int32_t share = (int32_t) (crossfade * 32768);
+        int32_t previous = waveform_fixed_value(previousWaveformIdx, currentPhase, increment);
+        value = previous + (((value - previous) * share) >> 15);
+    }
+    return value;
+}
+
+/*
+ * The value of the waveform with the given index at the given phase,
+ * as unsigned Q15.
+ */
+int32_t WaveSynth::waveform_fixed_value(int waveIdx, uint32_t currentPhase, uint32_t increment) {
+    
+    // Wavetables, timbres and morphs are only available in floating point
+    if (waveIdx == MORPH_IDX || waveIdx == COMPLEX_IDX || waveIdx >= NUM_BUILTIN_WAVEFORMS) {
+        double cyclePhase = currentPhase / 4294967296.0;
+        double cyclePeriod = 4294967296.0 / increment;
+        double value = (waveIdx == MORPH_IDX) ? morph_value(cyclePhase, cyclePeriod)
+                : table_value(waveIdx, cyclePhase, cyclePeriod);
+        return (int32_t) (value * INT16_MAX);
+    }
+    
+    const int16_t* table = &fixedWaveTables[waveIdx][0];
+    const int fractionShift = 32 - FIXED_TABLE_BITS - 15;
+    uint32_t idx = currentPhase >> (32 - FIXED_TABLE_BITS);
+    int32_t fraction = (currentPhase >> fractionShift) & 0x7FFF;
+    return table[idx] + (((table[idx+1] - table[idx]) * fraction) >> 15);
+}
+
+void WaveSynth::update_phase_increment() {
+    phaseIncrement = (uint32_t) (frequency * detune / sample_rate * 4294967296.0);
+}
+
+/*
+ * Derives the gain from the volume relative to full scale (not to
+ * max_volume), such that the samples match those of the
+ * floating-point path, whose values lie within [0, volume].
+ */
+void WaveSynth::update_gain() {
+    gain = (int32_t) (std::min(std::max(volume / UINT16_MAX, 0.0), 1.0) * INT32_MAX);
+}
+
+/*
+ * Samples one cycle of each waveform into a table.
+ */
+void WaveSynth::build_fixed_tables() {
+    
+    int numWaveforms = NUM_BUILTIN_WAVEFORMS;
+    fixedWaveTables.resize(numWaveforms);
+    
+    for (int w = 0; w < numWaveforms; w++) {
+        
+        wavefunc function = get_wave_function(WAVE_NAMES[w]);
+        if (function == NULL) {
+            continue;
+        }
+        std::vector<int16_t>& table = fixedWaveTables[w];
+        table.resize(FIXED_TABLE_SIZE + 1);
+        
+        for (int i = 0; i < FIXED_TABLE_SIZE; i++) {
+            double value = function(i, FIXED_TABLE_SIZE, 1.0);
+            if (!std::isfinite(value)) {
+                // e.g. the center of the single slit (0/0)
+                value = 1.0;
+            }
+            value = std::min(std::max(value, 0.0), 1.0);
+            table[i] = (int16_t) std::round(value * INT16_MAX);
+        }
+        table[FIXED_TABLE_SIZE] = table[0];
+    }
+}
+
+#endif
 
 /*
  * STATIC, STATELESS WAVE FUNCTIONS
@@ -632,12 +1013,80 @@ double WaveSynth::singleslit(double t, double period, double volume) {
     return (volume * value);
 }
 
-double WaveSynth::complex(double t, double period, double volume) {
-        
-    double sum = 0;
-    int numWaves = std::min(complexWaveLookup.frequency_ratios.size(), complexWaveLookup.shares.size());
-    for (int i = 0; i < numWaves; i++) {
-        sum += WaveSynth::sin(t, period / complexWaveLookup.frequency_ratios[i], volume * complexWaveLookup.shares[i]);
+/*
+ * ANTIALIASED WAVE FUNCTIONS
+ * The naive wave is corrected around each jump by the residual of a
+ * band-limited step (PolyBLEP) and around each corner by the residual
+ * of a band-limited ramp (PolyBLAMP, its integral), both approximated
+ * by polynomials over the sample before and after the discontinuity.
+ * As t advances by one per sample, 1/period is the phase per sample.
+ */
+
+/*
+ * Residual of a unit step at phase 0, at the phase p in [0,1)
+ * with the phase increment dt per sample.
+ */
+static double blep_residual(double p, double dt) {
+    
+    if (p < dt) {
+        double x = 1 - p / dt;
+        return -0.5 * x * x;
+    } else if (p > 1 - dt) {
+        double x = 1 - (1 - p) / dt;
+        return 0.5 * x * x;
+    }
+    return 0;
+}
+
+/*
+ * Residual of a change of the slope by one per sample at phase 0.
+ */
+static double blamp_residual(double p, double dt) {
+    
+    double x;
+    if (p < dt) {
+        x = 1 - p / dt;
+    } else if (p > 1 - dt) {
+        x = 1 - (1 - p) / dt;
+    } else {
+        return 0;
     }
-    return sum;
+    return x * x * x / 6;
+}
+
+double WaveSynth::square_polyblep(double t, double period, double volume) {
+    
+    double dt = 1 / period;
+    double p = phase_of(t, period);
+    double value = (p <= 0.5) ? 0 : 1.0;
+    value += blep_residual(phase_of(t, period, 0.5), dt) - blep_residual(p, dt);
+    return (volume * value);
+}
+
+double WaveSynth::plateau_polyblep(double t, double period, double volume) {
+    
+    // Slopes of +3 and -3 per period around a flat third
+    double dt = 1 / period;
+    double value = plateau(t, period, 1.0) 
+            + 3 * dt * (2 * blamp_residual(phase_of(t, period), dt)
+                        - blamp_residual(phase_of(t, period, 1 / 3.0), dt)
+                        - blamp_residual(phase_of(t, period, 2 / 3.0), dt));
+    return (volume * value);
+}
+
+double WaveSynth::triangle_polyblep(double t, double period, double volume) {
+    
+    // Slopes of +2 and -2 per period
+    double dt = 1 / period;
+    double value = triangle(t, period, 1.0)
+            + 4 * dt * (blamp_residual(phase_of(t, period), dt)
+                        - blamp_residual(phase_of(t, period, 0.5), dt));
+    return (volume * value);
+}
+
+double WaveSynth::saw_polyblep(double t, double period, double volume) {
+    
+    double dt = 1 / period;
+    double p = phase_of(t, period);
+    return (volume * (p - blep_residual(p, dt)));
 }
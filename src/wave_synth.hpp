@@ -1,12 +1,19 @@
 #ifndef THEREMIN_WAVESYNTH_H
 #define THEREMIN_WAVESYNTH_H
 
+#include <stdint.h>
 #include <cmath>
 #include <string>
 #include <vector>
 
 #include "const.h"
 #include "configuration.hpp"
+#include "pitch_quantizer.hpp"
+#include "tuning.hpp"
+#include "envelope.hpp"
+#include "lfo.hpp"
+#include "wavetable.hpp"
+#include "timbre.hpp"
 
 typedef double (*wavefunc)(double, double, double);
 
@@ -31,11 +38,6 @@ public:
         double wavePeriod;
     };
     
-    struct WaveLookupTable {
-        std::vector<double> frequency_ratios;
-        std::vector<double> shares;
-    };
-    
 private:
     Configuration* cfg;
     
@@ -44,13 +46,13 @@ private:
     
     int waveformIdx = 0;
     std::string waveform = WAVE_NAMES[waveformIdx];
+    // Wave functions of the built-in waveforms, with jumps and corners
+    // corrected where configured, indexed like WAVE_NAMES (NULL for
+    // those played from tables)
+    std::vector<wavefunc> waveFunctions;
     
     // Properties for audio synthesis
     double root12Of2 = std::pow(2.0, 1.0/12); // ratio between two half-tones
-    double freqA = 443.0; // calibration of standard pitch
-    double freqAis = freqA * root12Of2; // next half-tone next to standard pitch
-    double ratioInLog = std::log(freqAis) * M_LOG2E 
-            - std::log(freqA) * M_LOG2E; // logarithmic ratio between half-tones
     double minFreq;
     int maxVol;
     double numOctaves;
@@ -59,24 +61,54 @@ private:
     bool octaveOffset = false;
     double maxVolumeChangePerTick;
     
-    bool tremolo;
-    double tremoloIntensity;
-    double tremoloFrequency;
-    bool tremoloExiting = false;
-    double tremoloOffset = 0.0;
-    
-    double secondaryFrequency;
+    double secondaryFrequency = 0;
     double secondaryVolumeShare = 0.1;
     
     std::string autotuneMode;
+    Tuning tuning;
+    PitchQuantizer pitchQuantizer;
+    float lastFrequencyValue = 0;
     
     double volumeTarget = volume;
     
+    // Vibrato: the period follows the frequency detuned by the
+    // ratio detune, which is updated once per control block of the LFO
+    Lfo vibrato;
+    double vibratoDepth; // in semitones
+    double detune = 1;
+    
+#ifdef THEREMIN_FIXED_POINT
+    // Integer synthesis: phases in units of 2^-32 cycles, gain in Q31
+    uint32_t phase = 0;
+    uint32_t phaseIncrement;
+    uint32_t secondaryPhase = 0;
+    uint32_t secondaryPhaseIncrement = 0;
+    int32_t gain;
+#endif
+    
+    // Partials of the complex waveform, and the
+    // phases of its inharmonic partials
+    const Timbre* timbre;
+    std::vector<double> partialPhases;
+    
+    // Morphing: the waveforms of the morph waveform (indexed like
+    // waveformIdx) and the position within them, which glides towards
+    // its target by morphStep per sample. After a switch, the previous
+    // waveform fades out while crossfade rises from 0 to 1.
+    std::vector<int> morphWaveforms;
+    double morphPosition = 0;
+    double morphTarget = 0;
+    double morphStep = 1;
+    int previousWaveformIdx = 0;
+    double crossfade = 1;
+    
+    // Voices for the tones of the current chord and of released chords
+    // fading out, each one shaped by its envelope, and the indices of
+    // those playing in the order they were started; the others are free
+    static const int MAX_CHILD_VOICES = 8;
     std::vector<WaveSynth> children;
-    std::vector<WaveSynth> nextChildren;
-    double fadingOutFactor = 0;
-    double fadingInFactor = 1;
-    bool fading;
+    std::vector<int> playingChildren;
+    Envelope envelope;
     std::string currentChordName = "";
     
 // methods
@@ -91,32 +123,51 @@ public:
     void clear_child_notes();
     bool has_child_notes();
     
-    void align_frequency();
     void update_frequency(float value);
     void update_volume(float value);
     void toggle_mute();
     void set_octave_offset(bool offset);
-    void set_tremolo(bool shouldTremolo);
     void switch_waveform();
     void set_secondary_frequency(double secondaryFrequency);
     bool is_secondary_frequency_active();
     void set_autotune_mode(std::string mode);
+    void set_vibrato(bool enabled);
+    void set_morph_position(double position);
+    void apply_action(std::string action);
     
     double get_max_frequency();
     bool is_octave_offset();
-    bool is_tremolo_enabled();
+    bool is_vibrato_enabled();
     std::string get_waveform();
+    int get_num_waveforms();
+    double get_morph_position();
     std::string get_autotune_mode();
     std::string get_current_chord_name();
+    const Tuning& get_tuning();
     
     void volume_tick();
     
     double get_normalized_frequency(double f);
 
 private:
+    double wave_value(double t, double period);
+    double waveform_value(int idx, double t, double period);
+    double morph_value(double phase, double period);
+    double table_value(int idx, double phase, double period);
     void set_wave_offset(double t, WaveSmoothing* smoothing);
-    double get_tremolo_volume(double t);
-    wavefunc get_wave_function();
+    void update_period();
+    void release_child_notes();
+    static wavefunc get_wave_function(std::string waveform, bool polyblep = false);
+    static void build_morph_tables(const std::vector<int>& waveformIdcs);
+    
+#ifdef THEREMIN_FIXED_POINT
+    uint16_t wave_fixed(double t);
+    int32_t wave_fixed_value(uint32_t currentPhase, uint32_t increment);
+    int32_t waveform_fixed_value(int waveIdx, uint32_t currentPhase, uint32_t increment);
+    void update_phase_increment();
+    void update_gain();
+    static void build_fixed_tables();
+#endif
     
     static double sin(double t, double period, double volume);
     static double sin_assym(double t, double period, double volume);
@@ -129,7 +180,11 @@ private:
     static double gauss(double t, double period, double volume);
     static double halfcirc(double t, double period, double volume);
     static double singleslit(double t, double period, double volume);
-    static double complex(double t, double period, double volume);
+    
+    static double square_polyblep(double t, double period, double volume);
+    static double plateau_polyblep(double t, double period, double volume);
+    static double triangle_polyblep(double t, double period, double volume);
+    static double saw_polyblep(double t, double period, double volume);
 
 };
 
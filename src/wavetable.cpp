@@ -0,0 +1,419 @@
+#include <iostream>
+#include <algorithm>
+#include <complex>
+#include <chrono>
+#include <cmath>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wavetable.hpp"
+
+// Time after which a replaced table cannot be in use anymore
+#define WAVETABLE_RETIRE_MILLIS 1000
+// Longest accepted cycle, in samples
+#define WAVETABLE_MAX_CYCLE 65536
+
+typedef std::complex<double> Complex;
+
+static uint16_t read_u16(const uint8_t* bytes) {
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t* bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+/*
+ * Reads the first channel of a WAV file (16-bit or 24-bit integer, or
+ * 32-bit float samples) into [-1,1]. Returns an error message or NULL.
+ */
+static const char* parse_wav(const uint8_t* data, size_t size,
+                             std::vector<float>& cycle) {
+
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        return "not a WAV file";
+    }
+
+    int format = 0, channels = 0, bits = 0;
+    const uint8_t* samples = NULL;
+    size_t dataSize = 0;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const uint8_t* chunk = data + pos + 8;
+        size_t chunkSize = std::min((size_t) read_u32(data + pos + 4), size - pos - 8);
+        if (memcmp(data + pos, "fmt ", 4) == 0 && chunkSize >= 16) {
+            format = read_u16(chunk);
+            channels = read_u16(chunk + 2);
+            bits = read_u16(chunk + 14);
+            if (format == 0xFFFE && chunkSize >= 26) {
+                // WAVE_FORMAT_EXTENSIBLE: the actual format starts the subformat
+                format = read_u16(chunk + 24);
+            }
+        } else if (memcmp(data + pos, "data", 4) == 0) {
+            samples = chunk;
+            dataSize = chunkSize;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (samples == NULL || channels == 0) {
+        return "no audio data";
+    }
+    if (!(format == 1 && (bits == 16 || bits == 24)) && !(format == 3 && bits == 32)) {
+        return "only 16-bit, 24-bit or 32-bit float samples are supported";
+    }
+
+    int frameBytes = bits / 8 * channels;
+    size_t frames = dataSize / frameBytes;
+    if (frames < 2) {
+        return "less than two samples";
+    } else if (frames > WAVETABLE_MAX_CYCLE) {
+        return "too long for a single cycle";
+    }
+
+    cycle.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+        const uint8_t* sample = samples + i * frameBytes;
+        if (bits == 16) {
+            cycle[i] = (int16_t) read_u16(sample) / 32768.0f;
+        } else if (bits == 24) {
+            int32_t value = (sample[0] << 8) | (sample[1] << 16) | ((uint32_t) sample[2] << 24);
+            cycle[i] = value / 2147483648.0f;
+        } else {
+            memcpy(&cycle[i], sample, sizeof(float));
+        }
+    }
+    return NULL;
+}
+
+/*
+ * In-place radix-2 FFT (or its unscaled inverse).
+ */
+static void fft(std::vector<Complex>& values, bool inverse) {
+
+    int n = values.size();
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(values[i], values[j]);
+        }
+    }
+    for (int length = 2; length <= n; length <<= 1) {
+        Complex step = std::polar(1.0, (inverse ? 2 : -2) * M_PI / length);
+        for (int i = 0; i < n; i += length) {
+            Complex twiddle = 1;
+            for (int j = 0; j < length / 2; j++) {
+                Complex u = values[i + j];
+                Complex v = values[i + j + length / 2] * twiddle;
+                values[i + j] = u + v;
+                values[i + j + length / 2] = u - v;
+                twiddle *= step;
+            }
+        }
+    }
+}
+
+/*
+ * Loads the WAV file at the given path via mmap and converts it into
+ * band-limited tables. Returns NULL with an error message on failure.
+ */
+Wavetable* Wavetable::load(std::string path) {
+
+    const char* error = NULL;
+    std::vector<float> cycle;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        error = strerror(errno);
+    } else if (info.st_size == 0) {
+        error = "empty file";
+    } else {
+        void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            error = strerror(errno);
+        } else {
+            error = parse_wav((const uint8_t*) mapping, info.st_size, cycle);
+            munmap(mapping, info.st_size);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (error != NULL) {
+        std::cerr << "Error: Could not load wavetable \"" << path << "\" ("
+                << error << ")." << std::endl;
+        return NULL;
+    }
+
+    return from_cycle(cycle);
+}
+
+/*
+ * Creates the tables of a single cycle of samples within [-1,1].
+ */
+Wavetable* Wavetable::from_cycle(const std::vector<float>& cycle) {
+
+    // The cycle may have any length, hence a direct DFT (without DC)
+    int n = cycle.size();
+    int numHarmonics = std::min(SIZE / 2 - 1, n / 2);
+    std::vector<Complex> harmonics(numHarmonics + 1);
+    std::vector<Complex> roots(n);
+    for (int j = 0; j < n; j++) {
+        roots[j] = std::polar(1.0, -2 * M_PI * j / n);
+    }
+    for (int k = 1; k <= numHarmonics; k++) {
+        Complex sum = 0;
+        for (int j = 0; j < n; j++) {
+            sum += (double) cycle[j] * roots[((long) k * j) % n];
+        }
+        // Amplitudes, with the Nyquist frequency of the file only once
+        harmonics[k] = sum * ((2 * k == n ? 1.0 : 2.0) / n);
+    }
+    return from_harmonics(harmonics);
+}
+
+/*
+ * Creates the tables of a wave with the given (complex) amplitudes of
+ * its harmonics, starting with the fundamental at index 1. A positive
+ * headroom is added to the peak for the normalization, leaving room
+ * for other signals the caller adds.
+ */
+Wavetable* Wavetable::from_harmonics(const std::vector<Complex>& harmonics,
+                                     double headroom) {
+
+    Wavetable* table = new Wavetable();
+    table->build(harmonics, headroom);
+    return table;
+}
+
+/*
+ * Resynthesizes each level from the harmonics it may keep.
+ */
+void Wavetable::build(const std::vector<Complex>& harmonics, double headroom) {
+
+    int numHarmonics = std::min(SIZE / 2 - 1, (int) harmonics.size() - 1);
+
+    std::vector<std::vector<double> > levels(LEVELS, std::vector<double>(SIZE));
+    std::vector<Complex> spectrum(SIZE);
+    double peak = 0;
+    for (int level = 0; level < LEVELS; level++) {
+        int maxHarmonic = std::min(numHarmonics, (SIZE / 2) >> level);
+        std::fill(spectrum.begin(), spectrum.end(), Complex(0));
+        for (int k = 1; k <= maxHarmonic; k++) {
+            spectrum[k] = harmonics[k];
+        }
+        fft(spectrum, true);
+        for (int i = 0; i < SIZE; i++) {
+            levels[level][i] = spectrum[i].real();
+            peak = std::max(peak, std::abs(spectrum[i].real()));
+        }
+    }
+
+    // One normalization for all levels, to keep the loudness
+    // when the level changes with the pitch
+    normalization = peak + headroom;
+    if (normalization == 0) {
+        normalization = 1;
+    }
+    for (int level = 0; level < LEVELS; level++) {
+        for (int i = 0; i < SIZE; i++) {
+            tables[level][i] = 0.5 + 0.5 * levels[level][i] / normalization;
+        }
+        tables[level][SIZE] = tables[level][0];
+    }
+}
+
+/*
+ * The value within [0,1] at the phase within [0,1) of a wave with
+ * the given period in samples, which selects the level.
+ */
+double Wavetable::value(double phase, double period) const {
+
+    // The first level whose harmonics all stay below the Nyquist frequency
+    int level = 0;
+    double harmonics = SIZE / 2;
+    while (harmonics > 0.5 * period && level < LEVELS - 1) {
+        harmonics *= 0.5;
+        level++;
+    }
+
+    double x = phase * SIZE;
+    int idx = std::min((int) x, SIZE - 1);
+    double fraction = x - idx;
+    const float* table = tables[level];
+    return table[idx] + fraction * (table[idx + 1] - table[idx]);
+}
+
+double Wavetable::get_normalization() const {
+    return normalization;
+}
+
+WavetableLibrary::~WavetableLibrary() {
+
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        thread.join();
+    }
+    // The tables themselves are left alone, as another
+    // thread may still be rendering while exiting
+}
+
+/*
+ * Loads the tables of the given directory (if not empty) and
+ * keeps checking it for changes every pollMillis milliseconds
+ * (if positive). Only the first call has an effect.
+ */
+void WavetableLibrary::start(std::string directory, int pollMillis) {
+
+    if (started) {
+        return;
+    }
+    started = true;
+    this->directory = directory;
+    this->pollMillis = pollMillis;
+    if (directory.empty()) {
+        return;
+    }
+
+    // The initial tables are there right away, e.g. to be
+    // selected as the default waveform
+    poll();
+    if (pollMillis > 0) {
+        thread = std::thread(&WavetableLibrary::run, this);
+    }
+}
+
+int WavetableLibrary::size() {
+    return count.load(std::memory_order_acquire);
+}
+
+/*
+ * The current version of the table with the given index (< size()).
+ * Only valid for the duration of a sample.
+ */
+const Wavetable* WavetableLibrary::get(int idx) {
+    return tables[idx].load(std::memory_order_acquire);
+}
+
+std::string WavetableLibrary::get_name(int idx) {
+    return names[idx];
+}
+
+/*
+ * The index of the table with the given name, or -1.
+ */
+int WavetableLibrary::find(std::string name) {
+
+    int numTables = size();
+    for (int i = 0; i < numTables; i++) {
+        if (names[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void WavetableLibrary::run() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wakeup.wait_for(lock, std::chrono::milliseconds(pollMillis));
+        if (!stopping) {
+            lock.unlock();
+            poll();
+            lock.lock();
+        }
+    }
+}
+
+/*
+ * Loads all new and modified WAV files of the directory,
+ * and frees the replaced tables which are not in use anymore.
+ */
+void WavetableLibrary::poll() {
+
+    int64_t now = now_millis();
+    for (int i = retired.size() - 1; i >= 0; i--) {
+        if (now - retired[i].time >= WAVETABLE_RETIRE_MILLIS) {
+            delete retired[i].table;
+            retired.erase(retired.begin() + i);
+        }
+    }
+
+    DIR* dir = opendir(directory.c_str());
+    if (dir == NULL) {
+        return;
+    }
+    std::vector<std::string> files;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        std::string file = entry->d_name;
+        if (file.size() > 4 && file.compare(file.size() - 4, 4, ".wav") == 0) {
+            files.push_back(file);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+
+    for (int f = 0; f < files.size(); f++) {
+
+        std::string path = directory + "/" + files[f];
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            continue;
+        }
+        int64_t time = (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+        if (modified.count(files[f]) && modified[files[f]] == time) {
+            continue;
+        }
+
+        std::string name = files[f].substr(0, files[f].size() - 4);
+        int idx = find(name);
+        int numTables = size();
+        if (idx < 0 && numTables == MAX_WAVETABLES) {
+            if (!fullReported) {
+                std::cerr << "Error: Cannot load more than " << MAX_WAVETABLES
+                        << " wavetables." << std::endl;
+                fullReported = true;
+            }
+            continue;
+        }
+
+        // A file which fails to load is only retried once it changes again
+        modified[files[f]] = time;
+        Wavetable* table = Wavetable::load(path);
+        if (table == NULL) {
+            continue;
+        }
+
+        if (idx >= 0) {
+            Retired old = {tables[idx].exchange(table, std::memory_order_acq_rel), now};
+            retired.push_back(old);
+            std::cout << "Reloaded wavetable \"" << name << "\"." << std::endl;
+        } else {
+            names[numTables] = name;
+            tables[numTables].store(table, std::memory_order_relaxed);
+            count.store(numTables + 1, std::memory_order_release);
+            std::cout << "Loaded wavetable \"" << name << "\"." << std::endl;
+        }
+    }
+}
+
+int64_t WavetableLibrary::now_millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,100 @@
+#ifndef THEREMIN_WAVETABLE_H
+#define THEREMIN_WAVETABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <complex>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * One cycle of a user waveform (or of the harmonics of a Timbre, or of
+ * a built-in waveform to morph), converted into band-limited tables:
+ * level 0 keeps all harmonics a table can hold, each further level
+ * half as many, such that a tone can always be read from a table
+ * without harmonics above the Nyquist frequency. All levels share
+ * one normalization, and the values are unipolar within [0,1] like
+ * those of the built-in wave functions.
+ */
+class Wavetable {
+
+public:
+    static const int SIZE = 2048;
+    static const int LEVELS = 11;
+
+    static Wavetable* load(std::string path);
+    static Wavetable* from_cycle(const std::vector<float>& cycle);
+    static Wavetable* from_harmonics(const std::vector<std::complex<double> >& harmonics,
+                                     double headroom = 0);
+
+    double value(double phase, double period) const;
+    double get_normalization() const;
+
+private:
+    void build(const std::vector<std::complex<double> >& harmonics, double headroom);
+
+    // Each table with a guard entry for interpolation
+    float tables[LEVELS][SIZE + 1];
+    // Amplitude mapped to 1
+    double normalization;
+};
+
+/*
+ * The wavetables of all single-cycle WAV files in a directory, named
+ * after the files. A background thread rescans the directory and
+ * loads new and changed files: a table is converted completely before
+ * it is swapped in atomically, and the replaced version is only freed
+ * after a grace period in which no sample can still be reading it.
+ * Tables are never removed, such that their indices stay valid; a
+ * deleted file keeps its last version.
+ */
+class WavetableLibrary {
+
+public:
+    static const int MAX_WAVETABLES = 64;
+
+    ~WavetableLibrary();
+
+    void start(std::string directory, int pollMillis);
+
+    int size();
+    const Wavetable* get(int idx);
+    std::string get_name(int idx);
+    int find(std::string name);
+
+private:
+    struct Retired {
+        Wavetable* table;
+        int64_t time;
+    };
+
+    void run();
+    void poll();
+    static int64_t now_millis();
+
+    std::string directory;
+    int pollMillis;
+    bool started = false;
+
+    // Written by the polling thread only; a slot is complete
+    // before count is increased
+    std::atomic<Wavetable*> tables[MAX_WAVETABLES];
+    std::string names[MAX_WAVETABLES];
+    std::atomic<int> count{0};
+    bool fullReported = false;
+
+    // Modification time of each file when it was last loaded
+    std::map<std::string, int64_t> modified;
+    std::vector<Retired> retired;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+};
+
+#endif